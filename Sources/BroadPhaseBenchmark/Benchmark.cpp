@@ -0,0 +1,316 @@
+#include "Benchmark.h"
+
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <new>
+
+#include "GlobalVariables.h"
+#include "World.h"
+#include "Polygon.h"
+#include "Timer.h"
+#include "ThreadPool.h"
+#include "SweepBoxes.h"
+
+/*
+
+	ALLOCATION COUNTERS
+
+*/
+
+#pragma region AllocationCounters
+
+static std::atomic<size_t>	s_allocationCount(0);
+static std::atomic<size_t>	s_allocatedBytes(0);
+
+size_t	GetAllocationCount()
+{
+	return s_allocationCount;
+}
+
+size_t	GetAllocatedBytes()
+{
+	return s_allocatedBytes;
+}
+
+void* operator new(size_t size)
+{
+	++s_allocationCount;
+	s_allocatedBytes += size;
+
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+#pragma endregion
+
+
+
+static const char* s_distributionNames[(size_t)BodyDistribution::Count] =
+{
+	"uniform",
+	"clustered",
+	"columns",
+	"heterogeneous",
+};
+
+const char*	GetDistributionName(BodyDistribution distribution)
+{
+	return s_distributionNames[(size_t)distribution];
+}
+
+CBroadPhaseBenchmark::CBroadPhaseBenchmark(const SBenchmarkSettings& settings)
+	: m_settings(settings)
+{
+}
+
+void	CBroadPhaseBenchmark::Run(std::ostream& log)
+{
+	m_results.clear();
+
+	for (size_t bodyCount : m_settings.bodyCounts)
+	{
+		for (int distribution = 0; distribution < (int)BodyDistribution::Count; ++distribution)
+		{
+			for (int type = 0; type < (int)BroadPhaseType::Count; ++type)
+			{
+				if ((BroadPhaseType)type == BroadPhaseType::Brut && bodyCount > m_settings.brutMaxCount)
+					continue;
+
+				SBenchmarkResult result = RunBroadPhase((BodyDistribution)distribution, bodyCount, (BroadPhaseType)type);
+				m_results.push_back(result);
+
+				log << GetDistributionName(result.distribution) << " " << bodyCount << " " << GetBroadPhaseDesc(result.type).name
+					<< " : " << result.nsPerBody << " ns/body, " << result.pairsPerFrame << " pairs, "
+					<< result.allocationsPerFrame << " allocations/frame" << std::endl;
+			}
+		}
+	}
+}
+
+SBenchmarkResult	CBroadPhaseBenchmark::RunBroadPhase(BodyDistribution distribution, size_t bodyCount, BroadPhaseType type)
+{
+	// same world and same motion for every broadphase
+	BuildWorld(distribution, bodyCount);
+
+	IBroadPhase* broadPhase = CreateBroadPhase(type);
+	std::vector<SPolygonPair> pairsToCheck;
+
+	const float deltaTime = 1.0f / 60.0f;
+	for (size_t frame = 0; frame < m_settings.warmupFrames; ++frame)
+	{
+		MoveBodies(deltaTime);
+		gVars->pWorld->UpdateWorldSpace();
+		pairsToCheck.clear();
+		broadPhase->GetCollidingPairsToCheck(pairsToCheck);
+	}
+
+	double duration = 0.0;
+	size_t pairCount = 0;
+	size_t allocationCount = 0;
+	size_t allocatedBytes = 0;
+
+	CTimer timer;
+	for (size_t frame = 0; frame < m_settings.frames; ++frame)
+	{
+		MoveBodies(deltaTime);
+		pairsToCheck.clear();
+
+		// done by the engine before the broadphase, not timed
+		gVars->pWorld->UpdateWorldSpace();
+
+		size_t allocationsBefore = GetAllocationCount();
+		size_t bytesBefore = GetAllocatedBytes();
+
+		timer.Start();
+		broadPhase->GetCollidingPairsToCheck(pairsToCheck);
+		timer.Stop();
+
+		allocationCount += GetAllocationCount() - allocationsBefore;
+		allocatedBytes += GetAllocatedBytes() - bytesBefore;
+		duration += timer.GetDuration();
+		pairCount += pairsToCheck.size();
+	}
+
+	SBenchmarkResult result;
+	result.distribution = distribution;
+	result.bodyCount = bodyCount;
+	result.type = type;
+	result.running = broadPhase->GetName();
+
+	double frames = (double)Max(m_settings.frames, (size_t)1);
+	result.pairsPerFrame = pairCount / frames;
+	result.nsPerBody = duration * 1e9 / (frames * bodyCount);
+	result.allocationsPerFrame = allocationCount / frames;
+	result.bytesPerFrame = allocatedBytes / frames;
+
+	delete broadPhase;
+	return result;
+}
+
+void	CBroadPhaseBenchmark::BuildWorld(BodyDistribution distribution, size_t bodyCount)
+{
+	delete gVars->pWorld;
+	gVars->pWorld = new CWorld();
+
+	srand(m_settings.seed);
+
+	SRandomPolyParams params;
+	params.minPoints = 3;
+	params.maxPoints = 8;
+	params.minRadius = 0.5f;
+	params.maxRadius = 1.0f;
+	params.minSpeed = 1.0f;
+	params.maxSpeed = 5.0f;
+
+	// about the same density whatever the count
+	float worldSize = sqrtf((float)bodyCount) * 4.0f;
+	m_minBounds = Vec2(-worldSize, -worldSize) * 0.5f;
+	m_maxBounds = Vec2(worldSize, worldSize) * 0.5f;
+
+	switch (distribution)
+	{
+	case BodyDistribution::Uniform:
+	{
+		params.minBounds = m_minBounds;
+		params.maxBounds = m_maxBounds;
+		for (size_t i = 0; i < bodyCount; ++i)
+		{
+			gVars->pWorld->AddRandomPoly(params);
+		}
+		break;
+	}
+	case BodyDistribution::Clustered:
+	{
+		const size_t clusterSize = 250;
+		size_t clusterCount = Max(bodyCount / clusterSize, (size_t)1);
+		float clusterHalfSize = sqrtf((float)clusterSize) * 0.75f;
+
+		params.minSpeed = 0.5f;
+		params.maxSpeed = 2.0f;
+
+		Vec2 center;
+		for (size_t i = 0; i < bodyCount; ++i)
+		{
+			if (i % clusterSize == 0 && i / clusterSize < clusterCount)
+			{
+				center.x = Random(m_minBounds.x + clusterHalfSize, m_maxBounds.x - clusterHalfSize);
+				center.y = Random(m_minBounds.y + clusterHalfSize, m_maxBounds.y - clusterHalfSize);
+			}
+
+			params.minBounds = center - Vec2(clusterHalfSize, clusterHalfSize);
+			params.maxBounds = center + Vec2(clusterHalfSize, clusterHalfSize);
+			gVars->pWorld->AddRandomPoly(params);
+		}
+		break;
+	}
+	case BodyDistribution::Columns:
+	{
+		// piles of polygons slightly overlapping their neighbours, barely moving
+		size_t columnCount = Max((size_t)sqrtf((float)bodyCount) / 2, (size_t)1);
+		size_t rowCount = (bodyCount + columnCount - 1) / columnCount;
+		float columnSpacing = worldSize / (float)columnCount;
+		float rowSpacing = 1.2f;
+
+		params.minSpeed = 0.0f;
+		params.maxSpeed = 0.2f;
+
+		m_minBounds = Vec2(-worldSize * 0.5f, -1.0f);
+		m_maxBounds = Vec2(worldSize * 0.5f, rowCount * rowSpacing + 1.0f);
+
+		for (size_t i = 0; i < bodyCount; ++i)
+		{
+			Vec2 position(m_minBounds.x + ((i % columnCount) + 0.5f) * columnSpacing, (i / columnCount) * rowSpacing);
+			params.minBounds = position;
+			params.maxBounds = position;
+			gVars->pWorld->AddRandomPoly(params);
+		}
+		break;
+	}
+	case BodyDistribution::Heterogeneous:
+	{
+		// one polygon out of twenty is up to 20 times bigger
+		params.minBounds = m_minBounds;
+		params.maxBounds = m_maxBounds;
+		for (size_t i = 0; i < bodyCount; ++i)
+		{
+			bool large = (rand() % 20) == 0;
+			params.minRadius = large ? 5.0f : 0.2f;
+			params.maxRadius = large ? 20.0f : 1.0f;
+			gVars->pWorld->AddRandomPoly(params);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void	CBroadPhaseBenchmark::MoveBodies(float deltaTime)
+{
+	gVars->pWorld->ForEachPolygon([&](CPolygonPtr poly)
+	{
+		poly->position += poly->speed * deltaTime;
+
+		if ((poly->position.x < m_minBounds.x && poly->speed.x < 0.0f) || (poly->position.x > m_maxBounds.x && poly->speed.x > 0.0f))
+			poly->speed.x *= -1.0f;
+		if ((poly->position.y < m_minBounds.y && poly->speed.y < 0.0f) || (poly->position.y > m_maxBounds.y && poly->speed.y > 0.0f))
+			poly->speed.y *= -1.0f;
+	});
+}
+
+void	CBroadPhaseBenchmark::WriteJSON(std::ostream& out) const
+{
+	out << "{\n";
+	out << "\t\"seed\": " << m_settings.seed << ",\n";
+	out << "\t\"warmupFrames\": " << m_settings.warmupFrames << ",\n";
+	out << "\t\"frames\": " << m_settings.frames << ",\n";
+	out << "\t\"threads\": " << (gVars->pThreadPool ? gVars->pThreadPool->GetThreadCount() : 1) << ",\n";
+	out << "\t\"simd\": \"" << GetSIMDLevelName(GetSweepSIMDLevel()) << "\",\n";
+	out << "\t\"results\": [";
+
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const SBenchmarkResult& result = m_results[i];
+
+		out << (i == 0 ? "\n" : ",\n");
+		out << "\t\t{ \"distribution\": \"" << GetDistributionName(result.distribution) << "\""
+			<< ", \"bodies\": " << result.bodyCount
+			<< ", \"broadphase\": \"" << GetBroadPhaseDesc(result.type).name << "\""
+			<< ", \"running\": \"" << result.running << "\""
+			<< ", \"pairs\": " << result.pairsPerFrame
+			<< ", \"nsPerBody\": " << result.nsPerBody
+			<< ", \"allocationsPerFrame\": " << result.allocationsPerFrame
+			<< ", \"bytesPerFrame\": " << result.bytesPerFrame << " }";
+	}
+
+	out << "\n\t]\n";
+	out << "}\n";
+}
@@ -0,0 +1,76 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+
+enum class BodyDistribution : int
+{
+	Uniform = 0,	// same size polygons spread over the whole world
+	Clustered,		// dense groups with empty space between them
+	Columns,		// stacked columns, lots of touching neighbours
+	Heterogeneous,	// mostly small polygons with a few very large ones
+
+	Count,
+};
+
+const char*	GetDistributionName(BodyDistribution distribution);
+
+struct SBenchmarkSettings
+{
+	std::vector<size_t>	bodyCounts = { 100, 1000, 10000, 100000 };
+	size_t				warmupFrames = 5;
+	size_t				frames = 30;
+	unsigned int		seed = 1234;
+
+	// brute force sends every pair to the narrowphase, it is skipped above this count
+	size_t				brutMaxCount = 1000;
+};
+
+struct SBenchmarkResult
+{
+	BodyDistribution	distribution;
+	size_t				bodyCount;
+	BroadPhaseType		type;
+	std::string			running;		// algorithm actually used, for Auto
+
+	// averages over the measured frames
+	double				pairsPerFrame;
+	double				nsPerBody;
+	double				allocationsPerFrame;
+	double				bytesPerFrame;
+};
+
+// Builds worlds with CWorld::AddRandomPoly and times every broadphase on them,
+// without window or GL context.
+class CBroadPhaseBenchmark
+{
+public:
+	CBroadPhaseBenchmark(const SBenchmarkSettings& settings);
+
+	void	Run(std::ostream& log);
+	void	WriteJSON(std::ostream& out) const;
+
+private:
+	void	BuildWorld(BodyDistribution distribution, size_t bodyCount);
+	void	MoveBodies(float deltaTime);
+
+	SBenchmarkResult	RunBroadPhase(BodyDistribution distribution, size_t bodyCount, BroadPhaseType type);
+
+	SBenchmarkSettings				m_settings;
+	std::vector<SBenchmarkResult>	m_results;
+
+	// bodies bounce inside these bounds
+	Vec2							m_minBounds;
+	Vec2							m_maxBounds;
+};
+
+// Counters of the global operator new, only this executable replaces it
+size_t	GetAllocationCount();
+size_t	GetAllocatedBytes();
+
+#endif
@@ -0,0 +1,85 @@
+// BroadPhaseBenchmark.cpp : times every broadphase on generated worlds and writes the results as JSON.
+//
+// usage : BroadPhaseBenchmark [--frames N] [--seed N] [--counts 100,1000,...] [--out results.json]
+
+#pragma comment(lib, "legacy_stdio_definitions.lib")
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+#include "GlobalVariables.h"
+#include "ThreadPool.h"
+#include "World.h"
+
+#include "Benchmark.h"
+
+extern "C" { FILE __iob_func[3] = { *stdin,*stdout,*stderr }; }
+
+static std::vector<size_t> ParseCounts(const char* arg)
+{
+	std::vector<size_t> counts;
+	std::stringstream stream(arg);
+	std::string count;
+	while (std::getline(stream, count, ','))
+	{
+		if (!count.empty())
+			counts.push_back((size_t)strtoul(count.c_str(), nullptr, 10));
+	}
+	return counts;
+}
+
+int main(int argc, char** argv)
+{
+	SBenchmarkSettings settings;
+	const char* outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--frames") == 0 && hasValue)
+			settings.frames = (size_t)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			settings.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--counts") == 0 && hasValue)
+			settings.bodyCounts = ParseCounts(argv[++i]);
+		else if (strcmp(argv[i], "--out") == 0 && hasValue)
+			outPath = argv[++i];
+		else
+		{
+			std::cerr << "usage : " << argv[0] << " [--frames N] [--seed N] [--counts 100,1000,...] [--out results.json]" << std::endl;
+			return 1;
+		}
+	}
+
+	// no window, renderer or physic engine : only what the broadphases read
+	gVars = new SGlobalVariables();
+	gVars->pThreadPool = new CThreadPool();
+	gVars->bDebug = false;
+
+	CBroadPhaseBenchmark benchmark(settings);
+	benchmark.Run(std::cerr);
+
+	if (outPath)
+	{
+		std::ofstream file(outPath);
+		if (!file)
+		{
+			std::cerr << "cannot write " << outPath << std::endl;
+			return 1;
+		}
+		benchmark.WriteJSON(file);
+	}
+	else
+	{
+		benchmark.WriteJSON(std::cout);
+	}
+
+	delete gVars->pWorld;
+	delete gVars->pThreadPool;
+	delete gVars;
+	return 0;
+}
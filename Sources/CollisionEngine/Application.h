@@ -7,6 +7,8 @@
 #include "Renderer.h"
 #include "SceneManager.h"
 #include "World.h"
+#include "ThreadPool.h"
+#include "DebugDraw.h"
 
 void InitApplication(int width, int height, float worldHeight)
 {
@@ -16,6 +18,8 @@ void InitApplication(int width, int height, float worldHeight)
 	gVars->pRenderer = new CRenderer(worldHeight);
 	gVars->pSceneManager = new CSceneManager();
 	gVars->pPhysicEngine = new CPhysicEngine();
+	gVars->pThreadPool = new CThreadPool();
+	gVars->pDebugDraw = new CDebugDraw();
 
 	gVars->bDebug = false;
 }
@@ -18,6 +18,8 @@ class CPolygonMoverTool : public CBehavior
 
 		gVars->pWorld->ForEachPolygon([&](CPolygonPtr poly)
 		{
+			// moved by the step since the cache was refreshed
+			poly->UpdateWorldSpace();
 			if (poly->IsPointInside(mousePoint))
 			{
 				clickedPoly = poly;
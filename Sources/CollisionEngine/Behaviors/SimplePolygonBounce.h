@@ -16,11 +16,13 @@ private:
 
 		gVars->pPhysicEngine->ForEachCollision([&](const SCollision& collision)
 		{
-			collision.polyA->position += collision.normal * collision.distance * -0.5f;
-			collision.polyB->position += collision.normal * collision.distance * 0.5f;
+			const SContactPoint& contact = collision.manifold[0];
 
-			collision.polyA->speed.Reflect(collision.normal);
-			collision.polyB->speed.Reflect(collision.normal);
+			collision.polyA->position += contact.normal * contact.penetration * -0.5f;
+			collision.polyB->position += contact.normal * contact.penetration * 0.5f;
+
+			collision.polyA->speed.Reflect(contact.normal);
+			collision.polyB->speed.Reflect(contact.normal);
 		});
 
 		float hWidth = gVars->pRenderer->GetWorldWidth() * 0.5f;
@@ -1,33 +1,24 @@
 #pragma once
 
-#include <vector>
 #include <GL/glew.h>
 
 #include "Maths.h"
 
+// Debug display of a polygon AABB, the physics only use AABB
 class CBoxAABB 
 {
 private:
 
-	GLuint m_vertexBufferId;
+	// unit square, created on first draw
+	GLuint m_vertexBufferId = 0;
 
 public:
 
-	Vec2 minPoint, maxPoint;
-	Vec2 position;
-
 	bool isCollide = false;
 
-	std::vector<Vec2> points;
-
-	void Build(std::vector<Vec2>& points, const Vec2& pos);
-	void RefreshMinAndMax(std::vector<Vec2>& points);
-
 	void CreateBuffers();
 	void BindBuffers();
 	void DestroyBuffers();
 
-	void Draw(Vec2 position);
-	bool isColliding(CBoxAABB& other, const Vec2& otherPos);
+	void Draw(const AABB& box);
 };
-
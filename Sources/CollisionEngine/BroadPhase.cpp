@@ -0,0 +1,37 @@
+#include "BroadPhase.h"
+
+#include "BroadPhaseBrut.h"
+#include "BroadPhaseSAP.h"
+#include "BroadPhaseAABBTree.h"
+#include "BroadPhaseGrid.h"
+#include "BroadPhaseMBP.h"
+#include "BroadPhaseQuadTree.h"
+#include "BroadPhaseAuto.h"
+
+template<typename TBroadPhase>
+static IBroadPhase* CreateBroadPhaseOfType()
+{
+	return new TBroadPhase();
+}
+
+// same order as BroadPhaseType
+static const SBroadPhaseDesc s_broadPhaseDescs[(size_t)BroadPhaseType::Count] =
+{
+	{ BroadPhaseType::Brut,		"Brut",			&CreateBroadPhaseOfType<CBroadPhaseBrut> },
+	{ BroadPhaseType::SAP,		"SAP",			&CreateBroadPhaseOfType<CBroadPhaseSAP> },
+	{ BroadPhaseType::AABBTree,	"AABB tree",	&CreateBroadPhaseOfType<CBroadPhaseAABBTree> },
+	{ BroadPhaseType::Grid,		"Grid",			&CreateBroadPhaseOfType<CBroadPhaseGrid> },
+	{ BroadPhaseType::MBP,		"MBP",			&CreateBroadPhaseOfType<CBroadPhaseMBP> },
+	{ BroadPhaseType::QuadTree,	"Quadtree",		&CreateBroadPhaseOfType<CBroadPhaseQuadTree> },
+	{ BroadPhaseType::Auto,		"Auto",			&CreateBroadPhaseOfType<CBroadPhaseAuto> },
+};
+
+const SBroadPhaseDesc& GetBroadPhaseDesc(BroadPhaseType type)
+{
+	return s_broadPhaseDescs[(size_t)type];
+}
+
+IBroadPhase* CreateBroadPhase(BroadPhaseType type)
+{
+	return GetBroadPhaseDesc(type).create();
+}
@@ -3,10 +3,39 @@
 
 #include "PhysicEngine.h"
 
+enum class BroadPhaseType : int
+{
+	Brut = 0,
+	SAP,
+	AABBTree,
+	Grid,
+	MBP,
+	QuadTree,
+	Auto,
+
+	Count,
+};
+
 class IBroadPhase
 {
 public:
+	virtual ~IBroadPhase() = default;
+
 	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) = 0;
+
+	// name of the algorithm actually running, for display
+	virtual const char* GetName() const = 0;
 };
 
-#endif
\ No newline at end of file
+// Registry of the broadphase implementations
+struct SBroadPhaseDesc
+{
+	BroadPhaseType	type;
+	const char*		name;
+	IBroadPhase*	(*create)();
+};
+
+const SBroadPhaseDesc&	GetBroadPhaseDesc(BroadPhaseType type);
+IBroadPhase*			CreateBroadPhase(BroadPhaseType type);
+
+#endif
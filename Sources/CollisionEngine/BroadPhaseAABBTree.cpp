@@ -0,0 +1,504 @@
+#include "BroadPhaseAABBTree.h"
+
+#include <algorithm>
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+static uint64_t	MakePairKey(int a, int b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	return ((uint64_t)a << 32) | (uint64_t)(uint32_t)b;
+}
+
+CBroadPhaseAABBTree::CBroadPhaseAABBTree()
+	: m_root(AABB_TREE_NULL_NODE), m_freeList(AABB_TREE_NULL_NODE)
+{
+}
+
+void CBroadPhaseAABBTree::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	SyncProxies();
+	UpdateProxies();
+	UpdatePairs();
+
+	for (SAABBTreeProxy& proxy : m_proxies)
+	{
+		proxy.poly->boxAABB.isCollide = false;
+	}
+
+	// fat boxes overlap, keep only the pairs where the tight boxes overlap too
+	for (uint64_t key : m_pairs)
+	{
+		SAABBTreeProxy& proxyA = m_proxies[(size_t)(key >> 32)];
+		SAABBTreeProxy& proxyB = m_proxies[(size_t)(key & 0xFFFFFFFF)];
+
+		if (proxyA.box.Overlaps(proxyB.box))
+		{
+			pairsToCheck.push_back(SPolygonPair(proxyA.poly, proxyB.poly));
+
+			proxyA.poly->boxAABB.isCollide = true;
+			proxyB.poly->boxAABB.isCollide = true;
+		}
+	}
+}
+
+#pragma region Proxies
+
+void CBroadPhaseAABBTree::SyncProxies()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+
+	while (m_proxies.size() > polyCount)
+	{
+		DestroyProxy(m_proxies.size() - 1);
+		m_proxies.pop_back();
+	}
+
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygon* poly = gVars->pWorld->GetPolygon(i).get();
+
+		if (i >= m_proxies.size())
+		{
+			m_proxies.push_back(SAABBTreeProxy());
+			CreateProxy(i, poly);
+		}
+		else if (m_proxies[i].poly != poly)
+		{
+			// world moved an other polygon in this slot
+			DestroyProxy(i);
+			CreateProxy(i, poly);
+		}
+	}
+}
+
+void CBroadPhaseAABBTree::CreateProxy(size_t index, CPolygon* poly)
+{
+	SAABBTreeProxy& proxy = m_proxies[index];
+	proxy.poly = poly;
+	proxy.leaf = AllocateNode();
+
+	SAABBTreeNode& leaf = m_nodes[proxy.leaf];
+	leaf.proxy = (int)index;
+	leaf.height = 0;
+
+	// empty fat box, the first update will insert it
+	leaf.box = AABB(Vec2(FLT_MAX, FLT_MAX), Vec2(-FLT_MAX, -FLT_MAX));
+}
+
+void CBroadPhaseAABBTree::DestroyProxy(size_t index)
+{
+	SAABBTreeProxy& proxy = m_proxies[index];
+	if (proxy.leaf == AABB_TREE_NULL_NODE)
+		return;
+
+	if (m_nodes[proxy.leaf].parent != AABB_TREE_NULL_NODE || m_root == proxy.leaf)
+		RemoveLeaf(proxy.leaf);
+
+	FreeNode(proxy.leaf);
+	proxy.leaf = AABB_TREE_NULL_NODE;
+
+	m_pairs.erase(std::remove_if(m_pairs.begin(), m_pairs.end(), [&](uint64_t key)
+		{ return (size_t)(key >> 32) == index || (size_t)(key & 0xFFFFFFFF) == index; }), m_pairs.end());
+}
+
+void CBroadPhaseAABBTree::UpdateProxies()
+{
+	m_movedProxies.clear();
+
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		SAABBTreeProxy& proxy = m_proxies[i];
+		CPolygon* poly = proxy.poly;
+
+		proxy.moved = false;
+
+		SAABBTreeNode& leaf = m_nodes[proxy.leaf];
+
+		// static polygons are handled by the static broadphase, kept out of the tree
+		if (poly->IsStatic())
+		{
+			if (leaf.parent != AABB_TREE_NULL_NODE || m_root == proxy.leaf)
+			{
+				RemoveLeaf(proxy.leaf);
+				m_nodes[proxy.leaf].box = AABB(Vec2(FLT_MAX, FLT_MAX), Vec2(-FLT_MAX, -FLT_MAX));
+
+				// drops its pairs
+				proxy.moved = true;
+				m_movedProxies.push_back((int)i);
+			}
+			continue;
+		}
+
+		proxy.box = poly->GetWorldAABB();
+
+		if (leaf.box.Contains(proxy.box))
+			continue;
+
+		// left its fat box, reinsert with a new one
+		if (leaf.parent != AABB_TREE_NULL_NODE || m_root == proxy.leaf)
+			RemoveLeaf(proxy.leaf);
+
+		Vec2 margin(AABB_TREE_FAT_MARGIN, AABB_TREE_FAT_MARGIN);
+		Vec2 displacement = poly->speed * AABB_TREE_PREDICTION_TIME;
+
+		Vec2 fatMin = proxy.box.minPoint - margin;
+		Vec2 fatMax = proxy.box.maxPoint + margin;
+
+		if (displacement.x < 0.0f)
+			fatMin.x += displacement.x;
+		else
+			fatMax.x += displacement.x;
+
+		if (displacement.y < 0.0f)
+			fatMin.y += displacement.y;
+		else
+			fatMax.y += displacement.y;
+
+		m_nodes[proxy.leaf].box = AABB(fatMin, fatMax);
+
+		InsertLeaf(proxy.leaf);
+
+		proxy.moved = true;
+		m_movedProxies.push_back((int)i);
+	}
+}
+
+void CBroadPhaseAABBTree::UpdatePairs()
+{
+	if (m_movedProxies.empty())
+		return;
+
+	// pairs between non-moved proxies are still valid, only the moved ones are queried again
+	m_pairs.erase(std::remove_if(m_pairs.begin(), m_pairs.end(), [&](uint64_t key)
+		{ return m_proxies[(size_t)(key >> 32)].moved || m_proxies[(size_t)(key & 0xFFFFFFFF)].moved; }), m_pairs.end());
+
+	size_t keptCount = m_pairs.size();
+
+	for (int proxyId : m_movedProxies)
+	{
+		if (m_proxies[proxyId].poly->IsStatic())
+			continue;
+
+		const SAABBTreeNode& leaf = m_nodes[m_proxies[proxyId].leaf];
+		AABB box = leaf.box;
+
+		Query(box, [&](int otherId)
+		{
+			if (otherId == proxyId)
+				return;
+
+			// both moved, only add it once
+			if (m_proxies[otherId].moved && otherId < proxyId)
+				return;
+
+			m_pairs.push_back(MakePairKey(proxyId, otherId));
+		});
+	}
+
+	std::sort(m_pairs.begin() + keptCount, m_pairs.end());
+	std::inplace_merge(m_pairs.begin(), m_pairs.begin() + keptCount, m_pairs.end());
+}
+
+#pragma endregion
+
+#pragma region Tree
+
+int CBroadPhaseAABBTree::AllocateNode()
+{
+	if (m_freeList == AABB_TREE_NULL_NODE)
+	{
+		m_nodes.push_back(SAABBTreeNode());
+		m_nodes.back().height = 0;
+		return (int)m_nodes.size() - 1;
+	}
+
+	int node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+
+	m_nodes[node] = SAABBTreeNode();
+	m_nodes[node].height = 0;
+	return node;
+}
+
+void CBroadPhaseAABBTree::FreeNode(int node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+void CBroadPhaseAABBTree::InsertLeaf(int leaf)
+{
+	if (m_root == AABB_TREE_NULL_NODE)
+	{
+		m_root = leaf;
+		m_nodes[m_root].parent = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	AABB leafBox = m_nodes[leaf].box;
+
+	// find the best sibling, cost is the perimeter added to the tree
+	int index = m_root;
+	while (!m_nodes[index].IsLeaf())
+	{
+		const SAABBTreeNode& node = m_nodes[index];
+		int child1 = node.child1;
+		int child2 = node.child2;
+
+		float area = node.box.GetPerimeter();
+		float combinedArea = AABB::Combine(node.box, leafBox).GetPerimeter();
+
+		// cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		int children[2] = { child1, child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			const SAABBTreeNode& child = m_nodes[children[i]];
+
+			float newArea = AABB::Combine(child.box, leafBox).GetPerimeter();
+
+			if (child.IsLeaf())
+			{
+				childCosts[i] = newArea + inheritanceCost;
+			}
+			else
+			{
+				float oldArea = child.box.GetPerimeter();
+				childCosts[i] = (newArea - oldArea) + inheritanceCost;
+			}
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		index = (childCosts[0] < childCosts[1]) ? child1 : child2;
+	}
+
+	int sibling = index;
+
+	// create a new parent
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = AllocateNode();
+
+	SAABBTreeNode& parentNode = m_nodes[newParent];
+	parentNode.parent = oldParent;
+	parentNode.box = AABB::Combine(m_nodes[sibling].box, leafBox);
+	parentNode.height = m_nodes[sibling].height + 1;
+	parentNode.child1 = sibling;
+	parentNode.child2 = leaf;
+
+	if (oldParent != AABB_TREE_NULL_NODE)
+	{
+		if (m_nodes[oldParent].child1 == sibling)
+			m_nodes[oldParent].child1 = newParent;
+		else
+			m_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	// walk back up the tree fixing heights and boxes
+	index = m_nodes[leaf].parent;
+	while (index != AABB_TREE_NULL_NODE)
+	{
+		index = Balance(index);
+
+		SAABBTreeNode& node = m_nodes[index];
+		const SAABBTreeNode& child1 = m_nodes[node.child1];
+		const SAABBTreeNode& child2 = m_nodes[node.child2];
+
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.box = AABB::Combine(child1.box, child2.box);
+
+		index = node.parent;
+	}
+}
+
+void CBroadPhaseAABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	m_nodes[leaf].parent = AABB_TREE_NULL_NODE;
+
+	if (grandParent == AABB_TREE_NULL_NODE)
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = AABB_TREE_NULL_NODE;
+		FreeNode(parent);
+		return;
+	}
+
+	// destroy parent and connect sibling to grand parent
+	if (m_nodes[grandParent].child1 == parent)
+		m_nodes[grandParent].child1 = sibling;
+	else
+		m_nodes[grandParent].child2 = sibling;
+
+	m_nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	int index = grandParent;
+	while (index != AABB_TREE_NULL_NODE)
+	{
+		index = Balance(index);
+
+		SAABBTreeNode& node = m_nodes[index];
+		const SAABBTreeNode& child1 = m_nodes[node.child1];
+		const SAABBTreeNode& child2 = m_nodes[node.child2];
+
+		node.box = AABB::Combine(child1.box, child2.box);
+		node.height = 1 + std::max(child1.height, child2.height);
+
+		index = node.parent;
+	}
+}
+
+// Rotate A's children if they are unbalanced, returns the new root of this sub tree
+//       A
+//    +--+--+
+//    B     C
+//   +-+   +-+
+//   D E   F G
+int CBroadPhaseAABBTree::Balance(int iA)
+{
+	SAABBTreeNode* A = &m_nodes[iA];
+	if (A->IsLeaf() || A->height < 2)
+		return iA;
+
+	int iB = A->child1;
+	int iC = A->child2;
+	SAABBTreeNode* B = &m_nodes[iB];
+	SAABBTreeNode* C = &m_nodes[iC];
+
+	int balance = C->height - B->height;
+
+	// rotate C up
+	if (balance > 1)
+	{
+		int iF = C->child1;
+		int iG = C->child2;
+		SAABBTreeNode* F = &m_nodes[iF];
+		SAABBTreeNode* G = &m_nodes[iG];
+
+		C->child1 = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+
+		if (C->parent != AABB_TREE_NULL_NODE)
+		{
+			if (m_nodes[C->parent].child1 == iA)
+				m_nodes[C->parent].child1 = iC;
+			else
+				m_nodes[C->parent].child2 = iC;
+		}
+		else
+		{
+			m_root = iC;
+		}
+
+		// keep the highest child of C under C
+		if (F->height > G->height)
+		{
+			C->child2 = iF;
+			A->child2 = iG;
+			G->parent = iA;
+			A->box = AABB::Combine(B->box, G->box);
+			C->box = AABB::Combine(A->box, F->box);
+
+			A->height = 1 + std::max(B->height, G->height);
+			C->height = 1 + std::max(A->height, F->height);
+		}
+		else
+		{
+			C->child2 = iG;
+			A->child2 = iF;
+			F->parent = iA;
+			A->box = AABB::Combine(B->box, F->box);
+			C->box = AABB::Combine(A->box, G->box);
+
+			A->height = 1 + std::max(B->height, F->height);
+			C->height = 1 + std::max(A->height, G->height);
+		}
+
+		return iC;
+	}
+
+	// rotate B up
+	if (balance < -1)
+	{
+		int iD = B->child1;
+		int iE = B->child2;
+		SAABBTreeNode* D = &m_nodes[iD];
+		SAABBTreeNode* E = &m_nodes[iE];
+
+		B->child1 = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+
+		if (B->parent != AABB_TREE_NULL_NODE)
+		{
+			if (m_nodes[B->parent].child1 == iA)
+				m_nodes[B->parent].child1 = iB;
+			else
+				m_nodes[B->parent].child2 = iB;
+		}
+		else
+		{
+			m_root = iB;
+		}
+
+		// keep the highest child of B under B
+		if (D->height > E->height)
+		{
+			B->child2 = iD;
+			A->child1 = iE;
+			E->parent = iA;
+			A->box = AABB::Combine(C->box, E->box);
+			B->box = AABB::Combine(A->box, D->box);
+
+			A->height = 1 + std::max(C->height, E->height);
+			B->height = 1 + std::max(A->height, D->height);
+		}
+		else
+		{
+			B->child2 = iE;
+			A->child1 = iD;
+			D->parent = iA;
+			A->box = AABB::Combine(C->box, D->box);
+			B->box = AABB::Combine(A->box, E->box);
+
+			A->height = 1 + std::max(C->height, D->height);
+			B->height = 1 + std::max(A->height, E->height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+#pragma endregion
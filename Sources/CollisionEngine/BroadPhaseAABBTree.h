@@ -0,0 +1,112 @@
+#ifndef _BROAD_PHASE_AABB_TREE_H_
+#define _BROAD_PHASE_AABB_TREE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+
+#define AABB_TREE_NULL_NODE			-1
+#define AABB_TREE_FAT_MARGIN		0.1f			// world units added around every leaf box
+#define AABB_TREE_PREDICTION_TIME	(1.0f / 30.0f)	// leaf boxes are stretched along speed for this duration
+
+struct SAABBTreeNode
+{
+	bool	IsLeaf() const { return child1 == AABB_TREE_NULL_NODE; }
+
+	// fat box, enclose the children (or the polygon for a leaf)
+	AABB	box;
+
+	// parent when used, next free node when in free list
+	int		parent = AABB_TREE_NULL_NODE;
+	int		child1 = AABB_TREE_NULL_NODE;
+	int		child2 = AABB_TREE_NULL_NODE;
+
+	// leaf = 0, free node = -1
+	int		height = -1;
+
+	// polygon index, only for leaves
+	int		proxy = -1;
+};
+
+struct SAABBTreeProxy
+{
+	CPolygon*	poly = nullptr;
+	int			leaf = AABB_TREE_NULL_NODE;
+	bool		moved = false;
+
+	// tight box of this frame
+	AABB		box;
+};
+
+// Dynamic bounding volume tree, leaves hold fat AABBs and are only reinserted
+// when their polygon leaves it. Overlapping leaves are kept in a persistent pair list
+// so that polygons at rest cost nearly nothing.
+class CBroadPhaseAABBTree : public IBroadPhase
+{
+public:
+	CBroadPhaseAABBTree();
+
+	virtual const char* GetName() const override { return "AABB tree"; }
+
+	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
+
+private:
+	void	SyncProxies();
+	void	CreateProxy(size_t index, CPolygon* poly);
+	void	DestroyProxy(size_t index);
+	void	UpdateProxies();
+	void	UpdatePairs();
+
+	int		AllocateNode();
+	void	FreeNode(int node);
+
+	void	InsertLeaf(int leaf);
+	void	RemoveLeaf(int leaf);
+	int		Balance(int node);
+
+	template<typename TFunctor>
+	void	Query(const AABB& box, TFunctor functor)
+	{
+		m_stack.clear();
+		m_stack.push_back(m_root);
+
+		while (!m_stack.empty())
+		{
+			int nodeId = m_stack.back();
+			m_stack.pop_back();
+
+			if (nodeId == AABB_TREE_NULL_NODE)
+				continue;
+
+			const SAABBTreeNode& node = m_nodes[nodeId];
+			if (node.box.maxPoint.x < box.minPoint.x || node.box.minPoint.x > box.maxPoint.x ||
+				node.box.maxPoint.y < box.minPoint.y || node.box.minPoint.y > box.maxPoint.y)
+				continue;
+
+			if (node.IsLeaf())
+			{
+				functor(node.proxy);
+			}
+			else
+			{
+				m_stack.push_back(node.child1);
+				m_stack.push_back(node.child2);
+			}
+		}
+	}
+
+	std::vector<SAABBTreeNode>	m_nodes;
+	int							m_root;
+	int							m_freeList;
+
+	std::vector<SAABBTreeProxy>	m_proxies;
+	std::vector<int>			m_movedProxies;
+
+	// fat overlaps, sorted, key is (lowIndex << 32 | highIndex)
+	std::vector<uint64_t>		m_pairs;
+	std::vector<int>			m_stack;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "BroadPhaseAuto.h"
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+CBroadPhaseAuto::CBroadPhaseAuto()
+	: m_current(nullptr), m_currentType(BroadPhaseType::SAP), m_candidateType(BroadPhaseType::SAP), m_framesSinceSample(0)
+{
+}
+
+CBroadPhaseAuto::~CBroadPhaseAuto()
+{
+	delete m_current;
+}
+
+const char* CBroadPhaseAuto::GetName() const
+{
+	return m_current ? m_current->GetName() : "None";
+}
+
+BroadPhaseType CBroadPhaseAuto::GetCurrentType() const
+{
+	return m_currentType;
+}
+
+void CBroadPhaseAuto::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	if (m_current == nullptr)
+	{
+		m_currentType = SelectType();
+		m_candidateType = m_currentType;
+		m_current = CreateBroadPhase(m_currentType);
+	}
+	else if (++m_framesSinceSample >= AUTO_BROADPHASE_SAMPLE_FRAMES)
+	{
+		BroadPhaseType type = SelectType();
+
+		// switch only when two samples in a row agree, avoids going back and forth
+		if (type != m_currentType && type == m_candidateType)
+		{
+			delete m_current;
+			m_current = CreateBroadPhase(type);
+			m_currentType = type;
+		}
+		m_candidateType = type;
+	}
+
+	m_current->GetCollidingPairsToCheck(pairsToCheck);
+}
+
+BroadPhaseType CBroadPhaseAuto::SelectType()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+	size_t dynamicCount = 0;
+
+	float sizeSum = 0.0f;
+	float sqrSizeSum = 0.0f;
+	float motionSum = 0.0f;
+
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygonPtr poly = gVars->pWorld->GetPolygon(i);
+
+		// static polygons are not in the broadphase
+		if (poly->IsStatic())
+			continue;
+		++dynamicCount;
+
+		Vec2 boxSize = poly->GetWorldAABB().GetSize();
+
+		float size = Max(boxSize.x, boxSize.y);
+		sizeSum += size;
+		sqrSizeSum += size * size;
+
+		if (i < m_sampledPositions.size())
+			motionSum += (poly->position - m_sampledPositions[i]).GetLength();
+	}
+
+	int sampledFrames = Max(m_framesSinceSample, 1);
+	m_framesSinceSample = 0;
+
+	m_sampledPositions.resize(polyCount);
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		m_sampledPositions[i] = gVars->pWorld->GetPolygon(i)->position;
+	}
+
+	if (dynamicCount <= AUTO_BROADPHASE_SMALL_COUNT)
+		return BroadPhaseType::SAP;
+
+	// split on the worker threads
+	if (dynamicCount >= AUTO_BROADPHASE_LARGE_COUNT)
+		return BroadPhaseType::MBP;
+
+	float meanSize = sizeSum / (float)dynamicCount;
+	float variance = Max(sqrSizeSum / (float)dynamicCount - meanSize * meanSize, 0.0f);
+	float sizeVariation = (meanSize > 0.0f) ? sqrtf(variance) / meanSize : 0.0f;
+	float motion = (meanSize > 0.0f) ? motionSum / ((float)dynamicCount * (float)sampledFrames * meanSize) : 0.0f;
+
+	// few huge polygons among small ones, the sweep axis is poisoned
+	if (sizeVariation > AUTO_BROADPHASE_SIZE_VARIATION)
+		return BroadPhaseType::AABBTree;
+
+	// similar sizes moving fast, no temporal coherence to exploit
+	if (motion > AUTO_BROADPHASE_FAST_MOTION)
+		return BroadPhaseType::Grid;
+
+	return BroadPhaseType::SAP;
+}
@@ -0,0 +1,40 @@
+#ifndef _BROAD_PHASE_AUTO_H_
+#define _BROAD_PHASE_AUTO_H_
+
+#include <vector>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+
+#define AUTO_BROADPHASE_SAMPLE_FRAMES	30		// frames between two samples of the world
+#define AUTO_BROADPHASE_SMALL_COUNT		64		// under this polygon count the SAP is always used
+#define AUTO_BROADPHASE_LARGE_COUNT		2048	// over this polygon count the multi box pruning is always used
+#define AUTO_BROADPHASE_SIZE_VARIATION	1.0f	// box size standard deviation / mean above which the tree is used
+#define AUTO_BROADPHASE_FAST_MOTION		0.1f	// displacement per frame / mean box size above which the grid is used
+
+// Samples polygon count, size variation and motion every few frames
+// and migrates to the broadphase that fits best.
+class CBroadPhaseAuto : public IBroadPhase
+{
+public:
+	CBroadPhaseAuto();
+	virtual ~CBroadPhaseAuto();
+
+	virtual const char*	GetName() const override;
+
+	virtual void		GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
+
+	BroadPhaseType		GetCurrentType() const;
+
+private:
+	BroadPhaseType		SelectType();
+
+	IBroadPhase*		m_current;
+	BroadPhaseType		m_currentType;
+	BroadPhaseType		m_candidateType;
+
+	int					m_framesSinceSample;
+	std::vector<Vec2>	m_sampledPositions;
+};
+
+#endif
@@ -10,13 +10,22 @@
 class CBroadPhaseBrut : public IBroadPhase
 {
 public:
+	virtual const char* GetName() const override { return "Brut"; }
+
 	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override
 	{
+		// static polygons are handled by the static broadphase
 		for (size_t i = 0; i < gVars->pWorld->GetPolygonCount(); ++i)
 		{
+			if (gVars->pWorld->GetPolygon(i)->IsStatic())
+				continue;
+
 			for (size_t j = i + 1; j < gVars->pWorld->GetPolygonCount(); ++j)
 			{
-				pairsToCheck.push_back(SPolygonPair(gVars->pWorld->GetPolygon(i), gVars->pWorld->GetPolygon(j)));
+				if (gVars->pWorld->GetPolygon(j)->IsStatic())
+					continue;
+
+				pairsToCheck.push_back(SPolygonPair(gVars->pWorld->GetPolygon(i).get(), gVars->pWorld->GetPolygon(j).get()));
 			}
 		}
 	}
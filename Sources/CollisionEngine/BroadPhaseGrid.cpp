@@ -0,0 +1,253 @@
+#include "BroadPhaseGrid.h"
+
+#include <algorithm>
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+CBroadPhaseGrid::CBroadPhaseGrid(float cellSize)
+	: m_cellSize(cellSize), m_autoCellSize(cellSize <= 0.0f), m_framesSinceCellSize(0), m_bucketMask(0)
+{
+}
+
+void CBroadPhaseGrid::SetCellSize(float cellSize)
+{
+	m_cellSize = cellSize;
+	m_autoCellSize = cellSize <= 0.0f;
+	m_framesSinceCellSize = 0;
+}
+
+float CBroadPhaseGrid::GetCellSize() const
+{
+	return m_cellSize;
+}
+
+void CBroadPhaseGrid::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	size_t oldCount = m_proxies.size();
+
+	SyncProxies();
+	UpdateBounds();
+
+	if (m_autoCellSize && (m_cellSize <= 0.0f || oldCount != m_proxies.size() || m_framesSinceCellSize >= GRID_CELL_SIZE_REFRESH))
+	{
+		m_cellSize = ComputeMedianSize() * GRID_CELL_SIZE_FACTOR;
+		m_framesSinceCellSize = 0;
+	}
+	++m_framesSinceCellSize;
+
+	if (m_proxies.empty() || m_cellSize <= 0.0f)
+		return;
+
+	FillBuckets();
+
+	for (SGridProxy& proxy : m_proxies)
+	{
+		proxy.poly->boxAABB.isCollide = false;
+	}
+
+	for (size_t bucket = 0; bucket <= m_bucketMask; ++bucket)
+	{
+		uint32_t start = m_bucketStarts[bucket];
+		uint32_t end = m_bucketStarts[bucket + 1];
+
+		for (uint32_t i = start; i < end; ++i)
+		{
+			size_t proxyA = m_bucketProxies[i];
+			const SGridProxy& A = m_proxies[proxyA];
+
+			for (uint32_t j = i + 1; j < end; ++j)
+			{
+				size_t proxyB = m_bucketProxies[j];
+				const SGridProxy& B = m_proxies[proxyB];
+
+				if (!A.box.Overlaps(B.box))
+					continue;
+
+				// polygons sharing several cells, only the cell holding the min corner of the overlap reports them
+				int cellX = GetCell(Max(A.box.minPoint.x, B.box.minPoint.x));
+				int cellY = GetCell(Max(A.box.minPoint.y, B.box.minPoint.y));
+				if (GetBucket(cellX, cellY) != bucket)
+					continue;
+
+				AddPair(proxyA, proxyB, pairsToCheck);
+			}
+		}
+	}
+
+	// polygons too big for the grid are tested against all the others
+	for (size_t i = 0; i < m_oversizedProxies.size(); ++i)
+	{
+		size_t proxyA = m_oversizedProxies[i];
+		const SGridProxy& A = m_proxies[proxyA];
+
+		for (size_t proxyB = 0; proxyB < m_proxies.size(); ++proxyB)
+		{
+			const SGridProxy& B = m_proxies[proxyB];
+			if (proxyB == proxyA || !A.box.Overlaps(B.box))
+				continue;
+
+			// two oversized polygons, only add it once
+			if (B.minCellX > B.maxCellX && proxyB < proxyA)
+				continue;
+
+			AddPair(proxyA, proxyB, pairsToCheck);
+		}
+	}
+}
+
+void CBroadPhaseGrid::SyncProxies()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+
+	m_proxies.resize(polyCount);
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		m_proxies[i].poly = gVars->pWorld->GetPolygon(i).get();
+	}
+}
+
+void CBroadPhaseGrid::UpdateBounds()
+{
+	for (SGridProxy& proxy : m_proxies)
+	{
+		// static polygons are handled by the static broadphase, parked where they overlap nothing
+		if (proxy.poly->IsStatic())
+			proxy.box = AABB(Vec2(FLT_MAX, FLT_MAX), Vec2(FLT_MAX, FLT_MAX));
+		else
+			proxy.box = proxy.poly->GetWorldAABB();
+	}
+}
+
+float CBroadPhaseGrid::ComputeMedianSize() const
+{
+	if (m_proxies.empty())
+		return 0.0f;
+
+	std::vector<float> sizes;
+	sizes.reserve(m_proxies.size());
+	for (const SGridProxy& proxy : m_proxies)
+	{
+		if (proxy.poly->IsStatic())
+			continue;
+
+		Vec2 size = proxy.box.GetSize();
+		sizes.push_back(Max(size.x, size.y));
+	}
+
+	if (sizes.empty())
+		return 0.0f;
+
+	std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+	return sizes[sizes.size() / 2];
+}
+
+void CBroadPhaseGrid::FillBuckets()
+{
+	// about two buckets per polygon
+	size_t bucketCount = 1;
+	while (bucketCount < 2 * m_proxies.size())
+		bucketCount <<= 1;
+
+	m_bucketMask = bucketCount - 1;
+	m_bucketStarts.assign(bucketCount + 1, 0);
+	m_oversizedProxies.clear();
+
+	// count
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		SGridProxy& proxy = m_proxies[i];
+
+		// empty cell range
+		if (proxy.poly->IsStatic())
+		{
+			proxy.minCellX = proxy.minCellY = 1;
+			proxy.maxCellX = proxy.maxCellY = 0;
+			continue;
+		}
+
+		proxy.minCellX = GetCell(proxy.box.minPoint.x);
+		proxy.minCellY = GetCell(proxy.box.minPoint.y);
+		proxy.maxCellX = GetCell(proxy.box.maxPoint.x);
+		proxy.maxCellY = GetCell(proxy.box.maxPoint.y);
+
+		if ((int64_t)(proxy.maxCellX - proxy.minCellX + 1) * (proxy.maxCellY - proxy.minCellY + 1) > GRID_MAX_CELLS_PER_PROXY)
+		{
+			// empty cell range, keeps it out of the buckets
+			proxy.minCellX = 1;
+			proxy.maxCellX = 0;
+			m_oversizedProxies.push_back(i);
+			continue;
+		}
+
+		for (int y = proxy.minCellY; y <= proxy.maxCellY; ++y)
+		{
+			for (int x = proxy.minCellX; x <= proxy.maxCellX; ++x)
+			{
+				++m_bucketStarts[GetBucket(x, y) + 1];
+			}
+		}
+	}
+
+	for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+	{
+		m_bucketStarts[bucket + 1] += m_bucketStarts[bucket];
+	}
+
+	// fill, proxies are added in index order so a proxy found twice in a bucket is always contiguous
+	m_bucketProxies.resize(m_bucketStarts[bucketCount]);
+	std::vector<uint32_t> cursors(m_bucketStarts.begin(), m_bucketStarts.end() - 1);
+
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		const SGridProxy& proxy = m_proxies[i];
+
+		for (int y = proxy.minCellY; y <= proxy.maxCellY; ++y)
+		{
+			for (int x = proxy.minCellX; x <= proxy.maxCellX; ++x)
+			{
+				size_t bucket = GetBucket(x, y);
+				uint32_t& cursor = cursors[bucket];
+
+				if (cursor > m_bucketStarts[bucket] && m_bucketProxies[cursor - 1] == i)
+					continue;
+
+				m_bucketProxies[cursor++] = (uint32_t)i;
+			}
+		}
+	}
+
+	// remove the holes left by the skipped duplicates
+	uint32_t write = 0;
+	for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+	{
+		uint32_t start = m_bucketStarts[bucket];
+		m_bucketStarts[bucket] = write;
+
+		for (uint32_t i = start; i < cursors[bucket]; ++i)
+		{
+			m_bucketProxies[write++] = m_bucketProxies[i];
+		}
+	}
+	m_bucketStarts[bucketCount] = write;
+	m_bucketProxies.resize(write);
+}
+
+void CBroadPhaseGrid::AddPair(size_t proxyA, size_t proxyB, std::vector<SPolygonPair>& pairsToCheck)
+{
+	pairsToCheck.push_back(SPolygonPair(m_proxies[proxyA].poly, m_proxies[proxyB].poly));
+
+	m_proxies[proxyA].poly->boxAABB.isCollide = true;
+	m_proxies[proxyB].poly->boxAABB.isCollide = true;
+}
+
+int CBroadPhaseGrid::GetCell(float value) const
+{
+	return (int)floorf(Clamp(value / m_cellSize, -1.0e9f, 1.0e9f));
+}
+
+size_t CBroadPhaseGrid::GetBucket(int cellX, int cellY) const
+{
+	return (size_t)(((uint32_t)cellX * 73856093u) ^ ((uint32_t)cellY * 19349663u)) & m_bucketMask;
+}
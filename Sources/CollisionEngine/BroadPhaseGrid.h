@@ -0,0 +1,60 @@
+#ifndef _BROAD_PHASE_GRID_H_
+#define _BROAD_PHASE_GRID_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+
+#define GRID_CELL_SIZE_FACTOR		2.0f	// auto cell size is the median box size times this factor
+#define GRID_CELL_SIZE_REFRESH		60		// frames between two auto cell size computations
+#define GRID_MAX_CELLS_PER_PROXY	256		// bigger polygons are kept out of the grid and tested against all
+
+struct SGridProxy
+{
+	CPolygon*	poly = nullptr;
+	AABB		box;
+	int			minCellX, minCellY, maxCellX, maxCellY;
+};
+
+// Uniform grid hashed in a fixed number of buckets, rebuilt every frame with a counting sort.
+// Fits well large populations of polygons with similar size.
+class CBroadPhaseGrid : public IBroadPhase
+{
+public:
+	// a cell size of 0 means it is derived from the median box size
+	CBroadPhaseGrid(float cellSize = 0.0f);
+
+	void			SetCellSize(float cellSize);
+	float			GetCellSize() const;
+
+	virtual const char*	GetName() const override { return "Grid"; }
+
+	virtual void	GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
+
+private:
+	void			SyncProxies();
+	void			UpdateBounds();
+	float			ComputeMedianSize() const;
+
+	void			FillBuckets();
+	void			AddPair(size_t proxyA, size_t proxyB, std::vector<SPolygonPair>& pairsToCheck);
+
+	int				GetCell(float value) const;
+	size_t			GetBucket(int cellX, int cellY) const;
+
+	float						m_cellSize;
+	bool						m_autoCellSize;
+	int							m_framesSinceCellSize;
+
+	std::vector<SGridProxy>		m_proxies;
+	std::vector<size_t>			m_oversizedProxies;
+
+	// proxies of bucket i are m_bucketProxies[m_bucketStarts[i]] to m_bucketProxies[m_bucketStarts[i + 1]]
+	size_t						m_bucketMask;
+	std::vector<uint32_t>		m_bucketStarts;
+	std::vector<uint32_t>		m_bucketProxies;
+};
+
+#endif
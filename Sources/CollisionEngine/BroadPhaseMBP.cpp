@@ -0,0 +1,177 @@
+#include "BroadPhaseMBP.h"
+
+#include <algorithm>
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+#include "ThreadPool.h"
+
+// boxes given to the sweep kernel, its sweep axis is x
+static AABB	GetSweepBox(const AABB& box, int sweepAxis)
+{
+	if (sweepAxis == 0)
+		return box;
+
+	return AABB(Vec2(box.minPoint.y, box.minPoint.x), Vec2(box.maxPoint.y, box.maxPoint.x));
+}
+
+CBroadPhaseMBP::CBroadPhaseMBP()
+	: m_splitAxis(0), m_regionCount(0)
+{
+	m_regions.resize(MBP_MAX_REGIONS);
+}
+
+void CBroadPhaseMBP::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	UpdateBounds();
+
+	for (size_t i = 0; i < m_boxes.size(); ++i)
+	{
+		gVars->pWorld->GetPolygon(i)->boxAABB.isCollide = false;
+	}
+
+	if (m_dynamicProxies.empty())
+		return;
+
+	ComputeRegions();
+	FillRegions();
+
+	if (gVars->pThreadPool != nullptr)
+	{
+		gVars->pThreadPool->ParallelFor(m_regionCount, [this](size_t regionIndex, size_t)
+		{
+			SweepRegion(regionIndex);
+		});
+	}
+	else
+	{
+		for (size_t i = 0; i < m_regionCount; ++i)
+		{
+			SweepRegion(i);
+		}
+	}
+
+	// merged in region order, whatever the thread that swept them
+	for (size_t i = 0; i < m_regionCount; ++i)
+	{
+		for (uint64_t key : m_regions[i].pairs)
+		{
+			CPolygon* polyA = gVars->pWorld->GetPolygon((size_t)(key >> 32)).get();
+			CPolygon* polyB = gVars->pWorld->GetPolygon((size_t)(key & 0xFFFFFFFF)).get();
+
+			polyA->boxAABB.isCollide = true;
+			polyB->boxAABB.isCollide = true;
+
+			pairsToCheck.push_back(SPolygonPair(polyA, polyB));
+		}
+	}
+}
+
+void CBroadPhaseMBP::UpdateBounds()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+
+	m_boxes.resize(polyCount);
+	m_dynamicProxies.clear();
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygon* poly = gVars->pWorld->GetPolygon(i).get();
+
+		// static polygons are handled by the static broadphase
+		if (poly->IsStatic())
+			continue;
+
+		m_boxes[i] = poly->GetWorldAABB();
+		m_dynamicProxies.push_back((uint32_t)i);
+	}
+}
+
+void CBroadPhaseMBP::ComputeRegions()
+{
+	AABB bounds = m_boxes[m_dynamicProxies.front()];
+	for (uint32_t proxy : m_dynamicProxies)
+	{
+		bounds = AABB::Combine(bounds, m_boxes[proxy]);
+	}
+
+	// slabs across the longest side, they are swept along the shortest
+	Vec2 size = bounds.GetSize();
+	m_splitAxis = (size.x >= size.y) ? 0 : 1;
+
+	m_regionCount = Clamp(m_dynamicProxies.size() / MBP_PROXIES_PER_REGION, (size_t)1, (size_t)MBP_MAX_REGIONS);
+
+	// bounds at the centers quantiles, each region gets about the same number of polygons
+	m_centers.resize(m_dynamicProxies.size());
+	for (size_t i = 0; i < m_dynamicProxies.size(); ++i)
+	{
+		const AABB& box = m_boxes[m_dynamicProxies[i]];
+		m_centers[i] = (GetMin(box) + GetMax(box)) * 0.5f;
+	}
+
+	m_regionBounds.resize(m_regionCount - 1);
+	std::vector<float>::iterator first = m_centers.begin();
+	for (size_t i = 1; i < m_regionCount; ++i)
+	{
+		std::vector<float>::iterator nth = m_centers.begin() + i * m_centers.size() / m_regionCount;
+		std::nth_element(first, nth, m_centers.end());
+
+		m_regionBounds[i - 1] = *nth;
+		first = nth;
+	}
+}
+
+void CBroadPhaseMBP::FillRegions()
+{
+	int sweepAxis = 1 - m_splitAxis;
+
+	for (size_t i = 0; i < m_regionCount; ++i)
+	{
+		m_regions[i].proxies.clear();
+	}
+
+	// a polygon goes in every region it touches
+	for (uint32_t proxy : m_dynamicProxies)
+	{
+		const AABB& box = m_boxes[proxy];
+		float sweepMin = (sweepAxis == 0) ? box.minPoint.x : box.minPoint.y;
+
+		size_t lastRegion = GetRegion(GetMax(box));
+		for (size_t region = GetRegion(GetMin(box)); region <= lastRegion; ++region)
+		{
+			m_regions[region].proxies.push_back(std::make_pair(sweepMin, proxy));
+		}
+	}
+}
+
+void CBroadPhaseMBP::SweepRegion(size_t regionIndex)
+{
+	SMBPRegion& region = m_regions[regionIndex];
+	int sweepAxis = 1 - m_splitAxis;
+
+	std::sort(region.proxies.begin(), region.proxies.end());
+
+	region.sweepBoxes.Clear();
+	region.sweepBoxes.Reserve(region.proxies.size());
+	for (const std::pair<float, uint32_t>& proxy : region.proxies)
+	{
+		region.sweepBoxes.Add(proxy.second, GetSweepBox(m_boxes[proxy.second], sweepAxis));
+	}
+
+	region.pairs.clear();
+	region.sweepBoxes.FindOverlaps(region.pairs);
+
+	// keep the pairs whose overlap starts in this region, the others are reported by a neighbour
+	region.pairs.erase(std::remove_if(region.pairs.begin(), region.pairs.end(), [&](uint64_t key)
+	{
+		float overlapMin = Max(GetMin(m_boxes[(size_t)(key >> 32)]), GetMin(m_boxes[(size_t)(key & 0xFFFFFFFF)]));
+		return GetRegion(overlapMin) != regionIndex;
+	}), region.pairs.end());
+
+	std::sort(region.pairs.begin(), region.pairs.end());
+}
+
+size_t CBroadPhaseMBP::GetRegion(float value) const
+{
+	return std::upper_bound(m_regionBounds.begin(), m_regionBounds.end(), value) - m_regionBounds.begin();
+}
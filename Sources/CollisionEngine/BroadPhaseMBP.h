@@ -0,0 +1,60 @@
+#ifndef _BROAD_PHASE_MBP_H_
+#define _BROAD_PHASE_MBP_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+#include "SweepBoxes.h"
+
+#define MBP_MAX_REGIONS			16	// regions count, never depends on the thread count so the output does not either
+#define MBP_PROXIES_PER_REGION	64	// less regions are used when there are not enough polygons to fill them
+
+struct SMBPRegion
+{
+	// (min on the sweep axis, proxy), sorted before the sweep
+	std::vector<std::pair<float, uint32_t>>	proxies;
+	CSweepBoxes								sweepBoxes;
+
+	// pairs owned by this region, sorted
+	std::vector<uint64_t>					pairs;
+};
+
+// Multi box pruning: the world is cut in slabs holding the same number of polygons,
+// each slab is swept on its own by a worker thread. A pair of polygons straddling
+// several slabs is only reported by the slab holding the min of their overlap.
+class CBroadPhaseMBP : public IBroadPhase
+{
+public:
+	CBroadPhaseMBP();
+
+	virtual const char* GetName() const override { return "MBP"; }
+
+	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
+
+private:
+	void	UpdateBounds();
+	void	ComputeRegions();
+	void	FillRegions();
+	void	SweepRegion(size_t regionIndex);
+
+	size_t	GetRegion(float value) const;
+	float	GetMin(const AABB& box) const	{ return m_splitAxis == 0 ? box.minPoint.x : box.minPoint.y; }
+	float	GetMax(const AABB& box) const	{ return m_splitAxis == 0 ? box.maxPoint.x : box.maxPoint.y; }
+
+	std::vector<AABB>		m_boxes;
+	std::vector<uint32_t>	m_dynamicProxies;
+
+	// 0 : slabs cut along x (vertical), 1 : along y (horizontal), the sweep is done along the other axis
+	int						m_splitAxis;
+
+	// region i covers [m_regionBounds[i - 1], m_regionBounds[i]), first and last are open
+	std::vector<float>		m_regionBounds;
+	std::vector<SMBPRegion>	m_regions;
+	size_t					m_regionCount;
+
+	std::vector<float>		m_centers;
+};
+
+#endif
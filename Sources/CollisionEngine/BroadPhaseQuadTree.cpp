@@ -0,0 +1,321 @@
+#include "BroadPhaseQuadTree.h"
+
+#include <algorithm>
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+CBroadPhaseQuadTree::CBroadPhaseQuadTree()
+	: m_nodeCount(0), m_rootSize(1.0f), m_usedLevels(0)
+{
+}
+
+void CBroadPhaseQuadTree::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	SyncProxies();
+	UpdateBounds();
+	BuildNodes();
+
+	for (SQuadTreeProxy& proxy : m_proxies)
+	{
+		proxy.poly->boxAABB.isCollide = false;
+	}
+
+	for (uint32_t sortedA = 0; sortedA < m_sortedProxies.size(); ++sortedA)
+	{
+		const AABB& boxA = m_sortedBoxes[sortedA];
+		int levelA = m_proxies[m_sortedProxies[sortedA]].level;
+		Vec2 minPoint = boxA.minPoint - m_rootMin;
+		Vec2 maxPoint = boxA.maxPoint - m_rootMin;
+
+		// smaller polygons look for this one, only the own level and the coarser ones are visited
+		for (int level = 0; level <= levelA; ++level)
+		{
+			if (!(m_usedLevels & (1u << level)))
+				continue;
+
+			// nodes whose loose bounds overlap the box, at most 3 x 3 since the box is not larger than a cell
+			float cellSize = GetCellSize(level);
+			int maxCell = (1 << level) - 1;
+			int minX = Clamp((int)floorf(minPoint.x / cellSize - 0.5f), 0, maxCell);
+			int minY = Clamp((int)floorf(minPoint.y / cellSize - 0.5f), 0, maxCell);
+			int maxX = Clamp((int)floorf(maxPoint.x / cellSize + 0.5f), 0, maxCell);
+			int maxY = Clamp((int)floorf(maxPoint.y / cellSize + 0.5f), 0, maxCell);
+
+			for (int y = minY; y <= maxY; ++y)
+			{
+				for (int x = minX; x <= maxX; ++x)
+				{
+					const SQuadTreeNode* node = FindNode(MakeKey(level, x, y));
+					if (node == nullptr)
+						continue;
+
+					for (uint32_t sortedB = node->first; sortedB < node->first + node->count; ++sortedB)
+					{
+						// two polygons of the same level see each other, keep one
+						if (level == levelA && sortedB <= sortedA)
+							continue;
+
+						if (boxA.Overlaps(m_sortedBoxes[sortedB]))
+							AddPair(m_sortedProxies[sortedA], m_sortedProxies[sortedB], pairsToCheck);
+					}
+				}
+			}
+		}
+	}
+}
+
+void CBroadPhaseQuadTree::SyncProxies()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+
+	m_proxies.resize(polyCount);
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		m_proxies[i].poly = gVars->pWorld->GetPolygon(i).get();
+	}
+}
+
+void CBroadPhaseQuadTree::UpdateBounds()
+{
+	m_sortedProxies.clear();
+
+	AABB rootBox;
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		SQuadTreeProxy& proxy = m_proxies[i];
+
+		// static polygons are handled by the static broadphase
+		if (proxy.poly->IsStatic())
+		{
+			proxy.key = QUAD_TREE_EMPTY_KEY;
+			continue;
+		}
+
+		proxy.box = proxy.poly->GetWorldAABB();
+		rootBox = m_sortedProxies.empty() ? proxy.box : AABB::Combine(rootBox, proxy.box);
+		m_sortedProxies.push_back((uint32_t)i);
+	}
+
+	if (m_sortedProxies.empty())
+		return;
+
+	// a bit larger so that no center lies exactly on the far border
+	Vec2 rootExtent = rootBox.GetSize();
+	m_rootSize = Max(Max(rootExtent.x, rootExtent.y) * 1.01f, 1.0e-3f);
+	m_rootMin = rootBox.minPoint;
+
+	m_usedLevels = 0;
+	for (uint32_t proxyIndex : m_sortedProxies)
+	{
+		SQuadTreeProxy& proxy = m_proxies[proxyIndex];
+
+		// deepest level whose cells are still as large as the box
+		Vec2 boxExtent = proxy.box.GetSize();
+		float size = Max(boxExtent.x, boxExtent.y);
+		float cellSize = m_rootSize;
+		int level = 0;
+		while (level + 1 < QUAD_TREE_MAX_DEPTH && cellSize * 0.5f >= size)
+		{
+			cellSize *= 0.5f;
+			++level;
+		}
+
+		Vec2 center = proxy.box.GetCenter() - m_rootMin;
+		int maxCell = (1 << level) - 1;
+		int x = Clamp((int)(center.x / cellSize), 0, maxCell);
+		int y = Clamp((int)(center.y / cellSize), 0, maxCell);
+
+		proxy.level = level;
+		proxy.key = MakeKey(level, x, y);
+		m_usedLevels |= 1u << level;
+	}
+}
+
+void CBroadPhaseQuadTree::BuildNodes()
+{
+	// group the proxies by node, index order inside a node for a stable pair order.
+	// node key (36 bits) and proxy index are packed in a single integer, cheaper to sort
+	m_sortKeys.resize(m_sortedProxies.size());
+	for (size_t i = 0; i < m_sortedProxies.size(); ++i)
+	{
+		uint32_t proxyIndex = m_sortedProxies[i];
+		m_sortKeys[i] = (m_proxies[proxyIndex].key << QUAD_TREE_INDEX_BITS) | proxyIndex;
+	}
+	std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+	m_sortedBoxes.resize(m_sortedProxies.size());
+	for (size_t i = 0; i < m_sortKeys.size(); ++i)
+	{
+		uint32_t proxyIndex = (uint32_t)(m_sortKeys[i] & QUAD_TREE_INDEX_MASK);
+		m_sortedProxies[i] = proxyIndex;
+		m_sortedBoxes[i] = m_proxies[proxyIndex].box;
+	}
+
+	size_t capacity = 64;
+	while (capacity < 4 * m_sortedProxies.size())
+		capacity <<= 1;
+
+	m_nodes.assign(capacity, SQuadTreeNode());
+	m_nodeCount = 0;
+
+	uint32_t first = 0;
+	while (first < m_sortKeys.size())
+	{
+		uint64_t key = m_sortKeys[first] >> QUAD_TREE_INDEX_BITS;
+		uint32_t last = first + 1;
+		while (last < m_sortKeys.size() && (m_sortKeys[last] >> QUAD_TREE_INDEX_BITS) == key)
+			++last;
+
+		InsertNode(key, first, last - first);
+		first = last;
+	}
+}
+
+// Adds the node and the missing parents up to the root, so that the tree can be walked down
+void CBroadPhaseQuadTree::InsertNode(uint64_t key, uint32_t first, uint32_t count)
+{
+	while (true)
+	{
+		if (2 * (m_nodeCount + 1) > m_nodes.size())
+			RehashNodes(2 * m_nodes.size());
+
+		size_t mask = m_nodes.size() - 1;
+		size_t slot = GetHomeSlot(key);
+		while (m_nodes[slot].key != QUAD_TREE_EMPTY_KEY && m_nodes[slot].key != key)
+			slot = (slot + 1) & mask;
+
+		SQuadTreeNode& node = m_nodes[slot];
+		bool exists = node.key == key;
+		if (!exists)
+		{
+			node.key = key;
+			++m_nodeCount;
+		}
+		if (count > 0)
+		{
+			node.first = first;
+			node.count = count;
+		}
+
+		// a node already in the table has all its parents
+		int level = (int)(key >> QUAD_TREE_LEVEL_SHIFT);
+		if (exists || level == 0)
+			return;
+
+		key = GetParentKey(key);
+		count = 0;
+	}
+}
+
+void CBroadPhaseQuadTree::RehashNodes(size_t capacity)
+{
+	std::vector<SQuadTreeNode> oldNodes;
+	oldNodes.swap(m_nodes);
+	m_nodes.resize(capacity);
+
+	size_t mask = capacity - 1;
+	for (const SQuadTreeNode& node : oldNodes)
+	{
+		if (node.key == QUAD_TREE_EMPTY_KEY)
+			continue;
+
+		size_t slot = GetHomeSlot(node.key);
+		while (m_nodes[slot].key != QUAD_TREE_EMPTY_KEY)
+			slot = (slot + 1) & mask;
+
+		m_nodes[slot] = node;
+	}
+}
+
+void CBroadPhaseQuadTree::AddPair(uint32_t proxyA, uint32_t proxyB, std::vector<SPolygonPair>& pairsToCheck)
+{
+	// lowest index first, like the other broadphases
+	if (proxyA > proxyB)
+		std::swap(proxyA, proxyB);
+
+	pairsToCheck.push_back(SPolygonPair(m_proxies[proxyA].poly, m_proxies[proxyB].poly));
+
+	m_proxies[proxyA].poly->boxAABB.isCollide = true;
+	m_proxies[proxyB].poly->boxAABB.isCollide = true;
+}
+
+const SQuadTreeNode* CBroadPhaseQuadTree::FindNode(uint64_t key) const
+{
+	size_t mask = m_nodes.size() - 1;
+	size_t slot = GetHomeSlot(key);
+
+	while (m_nodes[slot].key != QUAD_TREE_EMPTY_KEY)
+	{
+		if (m_nodes[slot].key == key)
+			return &m_nodes[slot];
+
+		slot = (slot + 1) & mask;
+	}
+	return nullptr;
+}
+
+size_t CBroadPhaseQuadTree::GetHomeSlot(uint64_t key) const
+{
+	// fibonacci hashing of the 4 x 4 node block, the nodes of a block follow each other
+	// so that the neighbour lookups stay in the same cache lines
+	uint64_t hash = (key >> 4) * 0x9E3779B97F4A7C15ull;
+	return (size_t)(((hash >> 32) << 4) | (key & 0xF)) & (m_nodes.size() - 1);
+}
+
+AABB CBroadPhaseQuadTree::GetLooseBox(uint64_t key) const
+{
+	int level = (int)(key >> QUAD_TREE_LEVEL_SHIFT);
+	float cellSize = GetCellSize(level);
+	float x = (float)CompactBits((uint32_t)key);
+	float y = (float)CompactBits((uint32_t)key >> 1);
+
+	// the cell grown by half a cell on every side
+	Vec2 minPoint = m_rootMin + Vec2(x - 0.5f, y - 0.5f) * cellSize;
+	return AABB(minPoint, minPoint + Vec2(2.0f * cellSize, 2.0f * cellSize));
+}
+
+float CBroadPhaseQuadTree::GetCellSize(int level) const
+{
+	return ldexpf(m_rootSize, -level);
+}
+
+uint64_t CBroadPhaseQuadTree::MakeKey(int level, uint32_t x, uint32_t y)
+{
+	return ((uint64_t)level << QUAD_TREE_LEVEL_SHIFT) | (uint64_t)(SpreadBits(x) | (SpreadBits(y) << 1));
+}
+
+uint64_t CBroadPhaseQuadTree::GetParentKey(uint64_t key)
+{
+	uint64_t level = key >> QUAD_TREE_LEVEL_SHIFT;
+	return ((level - 1) << QUAD_TREE_LEVEL_SHIFT) | (uint64_t)((uint32_t)key >> 2);
+}
+
+// child bit 0 is x, bit 1 is y
+uint64_t CBroadPhaseQuadTree::GetChildKey(uint64_t key, uint32_t child)
+{
+	uint64_t level = key >> QUAD_TREE_LEVEL_SHIFT;
+	return ((level + 1) << QUAD_TREE_LEVEL_SHIFT) | (((uint64_t)(uint32_t)key << 2) | child);
+}
+
+// 16 bits to the even bits of 32
+uint32_t CBroadPhaseQuadTree::SpreadBits(uint32_t value)
+{
+	value &= 0xFFFF;
+	value = (value | (value << 8)) & 0x00FF00FF;
+	value = (value | (value << 4)) & 0x0F0F0F0F;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+	return value;
+}
+
+uint32_t CBroadPhaseQuadTree::CompactBits(uint32_t value)
+{
+	value &= 0x55555555;
+	value = (value | (value >> 1)) & 0x33333333;
+	value = (value | (value >> 2)) & 0x0F0F0F0F;
+	value = (value | (value >> 4)) & 0x00FF00FF;
+	value = (value | (value >> 8)) & 0x0000FFFF;
+	return value;
+}
@@ -0,0 +1,127 @@
+#ifndef _BROAD_PHASE_QUAD_TREE_H_
+#define _BROAD_PHASE_QUAD_TREE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "BroadPhase.h"
+#include "Maths.h"
+
+#define QUAD_TREE_MAX_DEPTH		16				// levels, cell coordinates fit in 16 bits
+#define QUAD_TREE_EMPTY_KEY		UINT64_MAX
+#define QUAD_TREE_LEVEL_SHIFT	32
+#define QUAD_TREE_INDEX_BITS	28				// node key and polygon index share a 64 bits sort key
+#define QUAD_TREE_INDEX_MASK	((1ull << QUAD_TREE_INDEX_BITS) - 1)
+
+struct SQuadTreeProxy
+{
+	CPolygon*	poly = nullptr;
+	AABB		box;
+
+	// node holding the polygon, QUAD_TREE_EMPTY_KEY for a static polygon
+	uint64_t	key = QUAD_TREE_EMPTY_KEY;
+	int			level = 0;
+};
+
+struct SQuadTreeNode
+{
+	// (level << 32 | morton code of x and y), QUAD_TREE_EMPTY_KEY when the slot is free
+	uint64_t	key = QUAD_TREE_EMPTY_KEY;
+
+	// proxies of the node are m_sortedProxies[first] to m_sortedProxies[first + count],
+	// count is 0 for a node only holding children
+	uint32_t	first = 0;
+	uint32_t	count = 0;
+};
+
+// Loose quadtree, a polygon is stored in the node of the level matching its size, the one
+// whose cell contains the box center and is at least as large as the box. Node bounds are
+// doubled so that they always enclose their polygons, and polygons never straddle nodes.
+// Nodes are kept in a hash table rebuilt every frame, only non empty branches exist.
+// Each polygon only looks at the few nodes around it on its own level and the coarser ones,
+// so big polygons do not slow down the small ones.
+class CBroadPhaseQuadTree : public IBroadPhase
+{
+public:
+	CBroadPhaseQuadTree();
+
+	virtual const char*	GetName() const override { return "Loose quadtree"; }
+
+	virtual void		GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
+
+	// calls functor(poly) for every dynamic polygon whose box strictly overlaps this one,
+	// the tree is the one of the last GetCollidingPairsToCheck
+	template<typename TFunctor>
+	void	Query(const AABB& box, TFunctor functor) const
+	{
+		if (m_nodes.empty() || m_sortedProxies.empty())
+			return;
+
+		// depth first, a node pushes its 4 children
+		uint64_t stack[3 * QUAD_TREE_MAX_DEPTH + 1];
+		size_t stackSize = 0;
+		stack[stackSize++] = MakeKey(0, 0, 0);
+
+		while (stackSize > 0)
+		{
+			uint64_t key = stack[--stackSize];
+			const SQuadTreeNode* node = FindNode(key);
+			if (node == nullptr || !GetLooseBox(key).Overlaps(box))
+				continue;
+
+			for (uint32_t i = node->first; i < node->first + node->count; ++i)
+			{
+				if (m_sortedBoxes[i].Overlaps(box))
+					functor(m_proxies[m_sortedProxies[i]].poly);
+			}
+
+			int level = (int)(key >> QUAD_TREE_LEVEL_SHIFT);
+			if (level + 1 >= QUAD_TREE_MAX_DEPTH || !(m_usedLevels >> (level + 1)))
+				continue;
+
+			for (uint32_t child = 0; child < 4; ++child)
+			{
+				stack[stackSize++] = GetChildKey(key, child);
+			}
+		}
+	}
+
+private:
+	void					SyncProxies();
+	void					UpdateBounds();
+	void					BuildNodes();
+	void					InsertNode(uint64_t key, uint32_t first, uint32_t count);
+	void					RehashNodes(size_t capacity);
+	void					AddPair(uint32_t proxyA, uint32_t proxyB, std::vector<SPolygonPair>& pairsToCheck);
+
+	const SQuadTreeNode*	FindNode(uint64_t key) const;
+	size_t					GetHomeSlot(uint64_t key) const;
+	AABB					GetLooseBox(uint64_t key) const;
+	float					GetCellSize(int level) const;
+
+	static uint64_t			MakeKey(int level, uint32_t x, uint32_t y);
+	static uint64_t			GetParentKey(uint64_t key);
+	static uint64_t			GetChildKey(uint64_t key, uint32_t child);
+	static uint32_t			SpreadBits(uint32_t value);
+	static uint32_t			CompactBits(uint32_t value);
+
+	std::vector<SQuadTreeProxy>	m_proxies;
+
+	// dynamic proxies sorted by node, with a copy of their box next to them
+	std::vector<uint32_t>		m_sortedProxies;
+	std::vector<AABB>			m_sortedBoxes;
+	std::vector<uint64_t>		m_sortKeys;
+
+	// open addressing hash table (linear probing), holds the nodes with polygons and their parents
+	std::vector<SQuadTreeNode>	m_nodes;
+	size_t						m_nodeCount;
+
+	// square enclosing all the dynamic polygons this frame
+	Vec2						m_rootMin;
+	float						m_rootSize;
+
+	// bit i is set when a polygon is stored on level i
+	uint32_t					m_usedLevels;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "BroadPhaseSAP.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+static uint64_t	MakePairKey(size_t a, size_t b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	return ((uint64_t)a << 32) | (uint64_t)b;
+}
+
+// at equal value a max is placed before a min, touching boxes are not overlapping
+static bool		IsLess(const SSAPEndPoint& a, const SSAPEndPoint& b)
+{
+	return a.value < b.value || (a.value == b.value && a.IsMax() && !b.IsMax());
+}
+
+void CBroadPhaseSAP::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	m_beganPairs.clear();
+	m_endedPairs.clear();
+
+	size_t oldCount = m_proxies.size();
+	bool rebuild = SyncProxies();
+
+	UpdateBounds();
+
+	if (rebuild)
+	{
+		RebuildAll();
+	}
+	else
+	{
+		// new proxies are added at the end, the sort will move them to their place
+		for (size_t i = oldCount; i < m_proxies.size(); ++i)
+		{
+			m_endPoints[0].push_back(SSAPEndPoint(m_proxies[i].box.minPoint.x, i, false));
+			m_endPoints[0].push_back(SSAPEndPoint(m_proxies[i].box.maxPoint.x, i, true));
+			m_endPoints[1].push_back(SSAPEndPoint(m_proxies[i].box.minPoint.y, i, false));
+			m_endPoints[1].push_back(SSAPEndPoint(m_proxies[i].box.maxPoint.y, i, true));
+		}
+
+		for (SSAPEndPoint& endPoint : m_endPoints[0])
+		{
+			const SSAPProxy& proxy = m_proxies[endPoint.GetProxy()];
+			endPoint.value = endPoint.IsMax() ? proxy.box.maxPoint.x : proxy.box.minPoint.x;
+		}
+		for (SSAPEndPoint& endPoint : m_endPoints[1])
+		{
+			const SSAPProxy& proxy = m_proxies[endPoint.GetProxy()];
+			endPoint.value = endPoint.IsMax() ? proxy.box.maxPoint.y : proxy.box.minPoint.y;
+		}
+
+		SortAxis(m_endPoints[0]);
+		SortAxis(m_endPoints[1]);
+	}
+
+	for (SSAPProxy& proxy : m_proxies)
+	{
+		proxy.poly->boxAABB.isCollide = false;
+	}
+
+	for (uint64_t key : m_pairs)
+	{
+		size_t indexA = (size_t)(key >> 32);
+		size_t indexB = (size_t)(key & 0xFFFFFFFF);
+
+		pairsToCheck.push_back(SPolygonPair(m_proxies[indexA].poly, m_proxies[indexB].poly));
+
+		m_proxies[indexA].poly->boxAABB.isCollide = true;
+		m_proxies[indexB].poly->boxAABB.isCollide = true;
+	}
+}
+
+bool CBroadPhaseSAP::SyncProxies()
+{
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+	bool rebuild = m_proxies.empty() || m_proxies.size() > polyCount;
+
+	m_proxies.resize(Min(m_proxies.size(), polyCount));
+	size_t oldCount = m_proxies.size();
+
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygon* poly = gVars->pWorld->GetPolygon(i).get();
+
+		if (i >= oldCount)
+		{
+			m_proxies.push_back(SSAPProxy());
+		}
+		else if (m_proxies[i].poly != poly)
+		{
+			// world moved an other polygon in this slot
+			rebuild = true;
+		}
+
+		m_proxies[i].poly = poly;
+	}
+
+	if (polyCount - oldCount > oldCount * SAP_REBUILD_RATIO)
+		rebuild = true;
+
+	return rebuild;
+}
+
+void CBroadPhaseSAP::UpdateBounds()
+{
+	for (SSAPProxy& proxy : m_proxies)
+	{
+		// static polygons are handled by the static broadphase, parked where they overlap nothing
+		if (proxy.poly->IsStatic())
+			proxy.box = AABB(Vec2(FLT_MAX, FLT_MAX), Vec2(FLT_MAX, FLT_MAX));
+		else
+			proxy.box = proxy.poly->GetWorldAABB();
+	}
+}
+
+// Full sort and sweep, used at load or when the world changed too much
+void CBroadPhaseSAP::RebuildAll()
+{
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		m_endPoints[axis].clear();
+		for (size_t i = 0; i < m_proxies.size(); ++i)
+		{
+			const SSAPProxy& proxy = m_proxies[i];
+			m_endPoints[axis].push_back(SSAPEndPoint(axis == 0 ? proxy.box.minPoint.x : proxy.box.minPoint.y, i, false));
+			m_endPoints[axis].push_back(SSAPEndPoint(axis == 0 ? proxy.box.maxPoint.x : proxy.box.maxPoint.y, i, true));
+		}
+
+		std::sort(m_endPoints[axis].begin(), m_endPoints[axis].end(), IsLess);
+	}
+
+	// boxes sorted along x in separate arrays, swept several at once. Sweeping like this every frame
+	// instead of the insertion sort only pays off on uniform scenes, not kept
+	m_sweepBoxes.Clear();
+	m_sweepBoxes.Reserve(m_proxies.size());
+	for (const SSAPEndPoint& endPoint : m_endPoints[0])
+	{
+		if (!endPoint.IsMax())
+			m_sweepBoxes.Add((uint32_t)endPoint.GetProxy(), m_proxies[endPoint.GetProxy()].box);
+	}
+
+	std::vector<uint64_t> newPairs;
+	m_sweepBoxes.FindOverlaps(newPairs);
+	std::sort(newPairs.begin(), newPairs.end());
+
+	// deltas against the previous pairs
+	std::vector<uint64_t> oldPairs = m_pairs;
+	std::sort(oldPairs.begin(), oldPairs.end());
+
+	std::set_difference(newPairs.begin(), newPairs.end(), oldPairs.begin(), oldPairs.end(), std::back_inserter(m_beganPairs));
+	std::set_difference(oldPairs.begin(), oldPairs.end(), newPairs.begin(), newPairs.end(), std::back_inserter(m_endedPairs));
+
+	m_pairs = newPairs;
+	m_pairIndices.clear();
+	for (size_t i = 0; i < m_pairs.size(); ++i)
+	{
+		m_pairIndices[m_pairs[i]] = i;
+	}
+}
+
+// Insertion sort, nearly free when the objects moved a little since last frame
+void CBroadPhaseSAP::SortAxis(std::vector<SSAPEndPoint>& endPoints)
+{
+	for (size_t i = 1; i < endPoints.size(); ++i)
+	{
+		SSAPEndPoint endPoint = endPoints[i];
+		size_t j = i;
+
+		while (j > 0 && IsLess(endPoint, endPoints[j - 1]))
+		{
+			const SSAPEndPoint& other = endPoints[j - 1];
+
+			if (endPoint.IsMax() != other.IsMax() && endPoint.GetProxy() != other.GetProxy())
+			{
+				// a min going left of a max may begin an overlap, a max going left of a min ends it
+				if (!endPoint.IsMax())
+				{
+					if (IsOverlapping(endPoint.GetProxy(), other.GetProxy()))
+						AddPair(endPoint.GetProxy(), other.GetProxy());
+				}
+				else
+				{
+					RemovePair(endPoint.GetProxy(), other.GetProxy());
+				}
+			}
+
+			endPoints[j] = other;
+			--j;
+		}
+
+		endPoints[j] = endPoint;
+	}
+}
+
+bool CBroadPhaseSAP::IsOverlapping(size_t proxyA, size_t proxyB) const
+{
+	return m_proxies[proxyA].box.Overlaps(m_proxies[proxyB].box);
+}
+
+void CBroadPhaseSAP::AddPair(size_t proxyA, size_t proxyB)
+{
+	uint64_t key = MakePairKey(proxyA, proxyB);
+	if (m_pairIndices.find(key) != m_pairIndices.end())
+		return;
+
+	m_pairIndices[key] = m_pairs.size();
+	m_pairs.push_back(key);
+	m_beganPairs.push_back(key);
+}
+
+void CBroadPhaseSAP::RemovePair(size_t proxyA, size_t proxyB)
+{
+	uint64_t key = MakePairKey(proxyA, proxyB);
+	auto it = m_pairIndices.find(key);
+	if (it == m_pairIndices.end())
+		return;
+
+	size_t index = it->second;
+	m_pairIndices.erase(it);
+
+	if (index + 1 < m_pairs.size())
+	{
+		m_pairs[index] = m_pairs.back();
+		m_pairIndices[m_pairs[index]] = index;
+	}
+	m_pairs.pop_back();
+
+	m_endedPairs.push_back(key);
+}
@@ -2,59 +2,67 @@
 
 #include "BroadPhase.h"
 
-#include "Polygon.h"
-#include "GlobalVariables.h"
-#include "World.h"
+#include "Maths.h"
+#include "SweepBoxes.h"
 
-#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
-// My custom broadPhase SAP
-class CBroadPhaseSAP : public IBroadPhase
+#define SAP_REBUILD_RATIO 0.25f // rebuild from scratch when more than this ratio of proxies are new
+
+struct SSAPEndPoint
 {
-public:
-	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override
-	{
+	SSAPEndPoint(float _value, size_t proxy, bool isMax) : value(_value), data((uint32_t)(proxy << 1) | (isMax ? 1 : 0)){}
+
+	size_t	GetProxy() const	{ return data >> 1; }
+	bool	IsMax() const		{ return (data & 1) != 0; }
 
-		std::vector<CPolygonPtr> poly;
-		poly.reserve(gVars->pWorld->GetPolygonCount());
+	float		value;
+	uint32_t	data;
+};
 
-		// Add to list, and rebuild aabb
-		for (size_t i = 0; i < gVars->pWorld->GetPolygonCount(); i++)
-		{
-			poly.push_back(gVars->pWorld->GetPolygon(i));
-			poly[i]->boxAABB.isCollide = false;
+struct SSAPProxy
+{
+	CPolygon*	poly = nullptr;
+	AABB		box;
+};
 
-			std::vector<Vec2> newPoints;
+// My custom broadPhase SAP
+// Sorted end points of both axes are kept between frames and repaired with an insertion sort,
+// each swap between a min and a max begins or ends an overlap.
+// The SIMD sweep of CSweepBoxes only runs on a full rebuild (load, or too many new / moved slots),
+// the frame to frame path has no sweep loop to vectorize.
+class CBroadPhaseSAP : public IBroadPhase
+{
+public:
+	virtual const char* GetName() const override { return "SAP"; }
 
-			for (Vec2 point : poly[i]->points)
-				newPoints.push_back(poly[i]->rotation * point);
+	virtual void GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck) override;
 
-			poly[i]->boxAABB.Build(newPoints, poly[i]->position);
+	// overlaps that began / ended during the last update, key is (lowIndex << 32 | highIndex)
+	const std::vector<uint64_t>&	GetBeganPairs() const { return m_beganPairs; }
+	const std::vector<uint64_t>&	GetEndedPairs() const { return m_endedPairs; }
 
-		}
+private:
+	bool	SyncProxies();
+	void	UpdateBounds();
 
+	void	RebuildAll();
+	void	SortAxis(std::vector<SSAPEndPoint>& endPoints);
 
-		// Sort by min x to max x the list of poly
-		std::sort(poly.begin(), poly.end(), [](CPolygonPtr& A, CPolygonPtr& B)
-			{ return  A->GetWolrdMinAABB().x < B->GetWolrdMinAABB().x; });
+	bool	IsOverlapping(size_t proxyA, size_t proxyB) const;
+	void	AddPair(size_t proxyA, size_t proxyB);
+	void	RemovePair(size_t proxyA, size_t proxyB);
 
-		for (size_t i = 0; i < gVars->pWorld->GetPolygonCount() ; i++)
-		{
+	std::vector<SSAPProxy>				m_proxies;
+	std::vector<SSAPEndPoint>			m_endPoints[2];
 
-			for (size_t j = i + 1; j < gVars->pWorld->GetPolygonCount() ; j++)
-			{	
-				if (poly[i]->GetWolrdMaxAABB().x < poly[j]->GetWolrdMinAABB().x)
-					break;
-			
-				if (poly[i]->boxAABB.isColliding(poly[j]->boxAABB, poly[j]->position))
-				{
-					pairsToCheck.push_back(SPolygonPair(poly[i], poly[j]));
+	std::vector<uint64_t>				m_pairs;
+	std::unordered_map<uint64_t, size_t>	m_pairIndices;
 
-					poly[i]->boxAABB.isCollide = true;
-					poly[j]->boxAABB.isCollide = true;
-				}
+	std::vector<uint64_t>				m_beganPairs;
+	std::vector<uint64_t>				m_endedPairs;
 
-			}
-		}
-	}
+	CSweepBoxes							m_sweepBoxes;
 };
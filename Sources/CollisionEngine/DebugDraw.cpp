@@ -0,0 +1,57 @@
+#include "DebugDraw.h"
+
+// buffer of the current thread and the debug draw it belongs to
+static thread_local const CDebugDraw*	s_threadOwner = nullptr;
+static thread_local void*				s_threadBuffer = nullptr;
+
+void	CDebugDraw::DrawLine(const Vec2& from, const Vec2& to, float r, float g, float b)
+{
+	GetThreadBuffer().lines.Push({ from, to, PackColor(r, g, b) });
+}
+
+void	CDebugDraw::DrawPoint(const Vec2& point, float r, float g, float b)
+{
+	GetThreadBuffer().points.Push({ point, PackColor(r, g, b) });
+}
+
+void	CDebugDraw::DrawLabel(DebugLabel label, float value, const Vec2& point)
+{
+	GetThreadBuffer().labels.Push({ point, value, label });
+}
+
+const char*	CDebugDraw::GetLabelName(DebugLabel label)
+{
+	switch (label)
+	{
+	case DebugLabel::Distance:		return "distance";
+	case DebugLabel::Penetration:	return "penetration";
+	default:						return "";
+	}
+}
+
+CDebugDraw::SThreadBuffer&	CDebugDraw::GetThreadBuffer()
+{
+	if (s_threadOwner != this)
+	{
+		std::lock_guard<std::mutex> lock(m_buffersMutex);
+
+		m_buffers.push_back(std::unique_ptr<SThreadBuffer>(new SThreadBuffer()));
+		s_threadOwner = this;
+		s_threadBuffer = m_buffers.back().get();
+	}
+
+	return *static_cast<SThreadBuffer*>(s_threadBuffer);
+}
+
+uint32_t	CDebugDraw::PackColor(float r, float g, float b)
+{
+	auto toByte = [](float value) { return (uint32_t)(Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+	return (toByte(r) << 16) | (toByte(g) << 8) | toByte(b);
+}
+
+void	CDebugDraw::UnpackColor(uint32_t color, float& r, float& g, float& b)
+{
+	r = (float)((color >> 16) & 0xFF) / 255.0f;
+	g = (float)((color >> 8) & 0xFF) / 255.0f;
+	b = (float)(color & 0xFF) / 255.0f;
+}
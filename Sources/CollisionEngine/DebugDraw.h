@@ -0,0 +1,136 @@
+#ifndef _DEBUG_DRAW_H_
+#define _DEBUG_DRAW_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "Maths.h"
+
+#define DEBUG_DRAW_MAX_LINES	4096	// per thread and per step, the oldest ones are overwritten
+#define DEBUG_DRAW_MAX_POINTS	1024
+#define DEBUG_DRAW_MAX_LABELS	1024
+
+// text of a label, formatted with its value when drawn
+enum class DebugLabel : uint8_t
+{
+	Distance = 0,
+	Penetration,
+
+	Count,
+};
+
+struct SDebugLine
+{
+	Vec2		from;
+	Vec2		to;
+	uint32_t	color;	// RGB8
+};
+
+struct SDebugPoint
+{
+	Vec2		point;
+	uint32_t	color;
+};
+
+struct SDebugLabel
+{
+	Vec2		point;
+	float		value;
+	DebugLabel	label;
+};
+
+// fixed size, keeps the last Size items pushed
+template<typename T, size_t Size>
+struct SDebugRing
+{
+	T		items[Size];
+	size_t	pushCount = 0;
+
+	void	Push(const T& item) { items[pushCount++ % Size] = item; }
+	void	Clear() { pushCount = 0; }
+
+	template<typename TFunctor>
+	void	ForEach(TFunctor functor) const
+	{
+		size_t count = pushCount < Size ? pushCount : Size;
+		for (size_t i = pushCount - count; i < pushCount; ++i)
+		{
+			functor(items[i % Size]);
+		}
+	}
+};
+
+// Debug primitives of the physics code, pushed from any thread without touching the renderer.
+// Each thread has its own ring buffers, the renderer draws them once the step is done.
+class CDebugDraw
+{
+public:
+	// physics side, any thread
+	void	DrawLine(const Vec2& from, const Vec2& to, float r, float g, float b);
+	void	DrawPoint(const Vec2& point, float r, float g, float b);
+	void	DrawLabel(DebugLabel label, float value, const Vec2& point);
+
+	// renderer side, no physics running. Calls lineFunctor(from, to, r, g, b) and
+	// labelFunctor(text, point), points are drawn as small crosses, then empties the buffers
+	template<typename TLineFunctor, typename TLabelFunctor>
+	void	Flush(TLineFunctor lineFunctor, TLabelFunctor labelFunctor);
+
+	static const char*	GetLabelName(DebugLabel label);
+
+private:
+	struct SThreadBuffer
+	{
+		SDebugRing<SDebugLine, DEBUG_DRAW_MAX_LINES>	lines;
+		SDebugRing<SDebugPoint, DEBUG_DRAW_MAX_POINTS>	points;
+		SDebugRing<SDebugLabel, DEBUG_DRAW_MAX_LABELS>	labels;
+	};
+
+	SThreadBuffer&	GetThreadBuffer();
+
+	static uint32_t	PackColor(float r, float g, float b);
+	static void		UnpackColor(uint32_t color, float& r, float& g, float& b);
+
+	// one per thread that drew something, only locked when a thread draws for the first time
+	std::vector<std::unique_ptr<SThreadBuffer>>	m_buffers;
+	std::mutex										m_buffersMutex;
+};
+
+template<typename TLineFunctor, typename TLabelFunctor>
+void	CDebugDraw::Flush(TLineFunctor lineFunctor, TLabelFunctor labelFunctor)
+{
+	std::lock_guard<std::mutex> lock(m_buffersMutex);
+
+	for (std::unique_ptr<SThreadBuffer>& buffer : m_buffers)
+	{
+		float r, g, b;
+
+		buffer->lines.ForEach([&](const SDebugLine& line)
+		{
+			UnpackColor(line.color, r, g, b);
+			lineFunctor(line.from, line.to, r, g, b);
+		});
+
+		buffer->points.ForEach([&](const SDebugPoint& point)
+		{
+			const float size = 0.1f;
+
+			UnpackColor(point.color, r, g, b);
+			lineFunctor(point.point - Vec2(size, size), point.point + Vec2(size, size), r, g, b);
+			lineFunctor(point.point - Vec2(size, -size), point.point + Vec2(size, -size), r, g, b);
+		});
+
+		buffer->labels.ForEach([&](const SDebugLabel& label)
+		{
+			labelFunctor(std::string(GetLabelName(label.label)) + " : " + std::to_string(label.value), label.point);
+		});
+
+		buffer->lines.Clear();
+		buffer->points.Clear();
+		buffer->labels.Clear();
+	}
+}
+
+#endif
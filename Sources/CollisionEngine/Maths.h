@@ -236,6 +236,55 @@ struct Line
 	}
 };
 
+// Axis aligned box, plain min / max, cheap enough to be built every frame
+struct AABB
+{
+	Vec2 minPoint, maxPoint;
+
+	AABB() = default;
+	AABB(const Vec2& _minPoint, const Vec2& _maxPoint) : minPoint(_minPoint), maxPoint(_maxPoint){}
+
+	Vec2	GetSize() const
+	{
+		return maxPoint - minPoint;
+	}
+
+	Vec2	GetCenter() const
+	{
+		return (minPoint + maxPoint) * 0.5f;
+	}
+
+	float	GetPerimeter() const
+	{
+		return 2.0f * ((maxPoint.x - minPoint.x) + (maxPoint.y - minPoint.y));
+	}
+
+	// touching boxes are not overlapping
+	bool	Overlaps(const AABB& other) const
+	{
+		return	minPoint.x < other.maxPoint.x && maxPoint.x > other.minPoint.x &&
+				minPoint.y < other.maxPoint.y && maxPoint.y > other.minPoint.y;
+	}
+
+	bool	Contains(const AABB& other) const
+	{
+		return	minPoint.x <= other.minPoint.x && minPoint.y <= other.minPoint.y &&
+				other.maxPoint.x <= maxPoint.x && other.maxPoint.y <= maxPoint.y;
+	}
+
+	void	Extend(const Vec2& point)
+	{
+		minPoint = Vec2(Min(minPoint.x, point.x), Min(minPoint.y, point.y));
+		maxPoint = Vec2(Max(maxPoint.x, point.x), Max(maxPoint.y, point.y));
+	}
+
+	static AABB	Combine(const AABB& a, const AABB& b)
+	{
+		return AABB(Vec2(Min(a.minPoint.x, b.minPoint.x), Min(a.minPoint.y, b.minPoint.y)),
+					Vec2(Max(a.maxPoint.x, b.maxPoint.x), Max(a.maxPoint.y, b.maxPoint.y)));
+	}
+};
+
 
 
 #endif
\ No newline at end of file
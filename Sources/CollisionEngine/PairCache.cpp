@@ -0,0 +1,162 @@
+#include "PairCache.h"
+
+#include <utility>
+
+#include "Polygon.h"
+
+static uint64_t	MakePairKey(size_t a, size_t b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	return ((uint64_t)a << 32) | (uint64_t)b;
+}
+
+CPairCache::CPairCache()
+	: m_count(0), m_frame(0)
+{
+	m_entries.resize(PAIR_CACHE_MIN_CAPACITY);
+}
+
+void CPairCache::Clear()
+{
+	m_entries.assign(PAIR_CACHE_MIN_CAPACITY, SPairCacheEntry());
+	m_count = 0;
+	m_frame = 0;
+}
+
+void CPairCache::BeginFrame()
+{
+	++m_frame;
+}
+
+void CPairCache::Reserve(size_t count)
+{
+	size_t capacity = m_entries.size();
+	while ((float)count > (float)capacity * PAIR_CACHE_MAX_LOAD)
+		capacity <<= 1;
+
+	if (capacity != m_entries.size())
+		Rehash(capacity);
+}
+
+SPairCacheEntry* CPairCache::Add(CPolygon* polyA, CPolygon* polyB, bool& isNew)
+{
+	if (polyA->GetIndex() > polyB->GetIndex())
+		std::swap(polyA, polyB);
+
+	uint64_t key = MakePairKey(polyA->GetIndex(), polyB->GetIndex());
+	size_t mask = m_entries.size() - 1;
+	size_t slot = GetHomeSlot(key);
+
+	while (m_entries[slot].key != PAIR_CACHE_EMPTY_KEY)
+	{
+		SPairCacheEntry& entry = m_entries[slot];
+		if (entry.key == key)
+		{
+			// the world moved other polygons in these slots, it is not the same pair
+			isNew = (entry.polyA != polyA || entry.polyB != polyB);
+			if (isNew)
+			{
+				entry = SPairCacheEntry();
+				entry.key = key;
+				entry.polyA = polyA;
+				entry.polyB = polyB;
+			}
+
+			entry.frame = m_frame;
+			return &entry;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	if ((float)(m_count + 1) > (float)m_entries.size() * PAIR_CACHE_MAX_LOAD)
+	{
+		Rehash(m_entries.size() * 2);
+		return Add(polyA, polyB, isNew);
+	}
+
+	SPairCacheEntry& entry = m_entries[slot];
+	entry = SPairCacheEntry();
+	entry.key = key;
+	entry.polyA = polyA;
+	entry.polyB = polyB;
+	entry.frame = m_frame;
+	++m_count;
+
+	isNew = true;
+	return &entry;
+}
+
+SPairCacheEntry* CPairCache::Find(size_t indexA, size_t indexB)
+{
+	size_t slot = FindSlot(MakePairKey(indexA, indexB));
+	return (slot < m_entries.size()) ? &m_entries[slot] : nullptr;
+}
+
+size_t CPairCache::GetHomeSlot(uint64_t key) const
+{
+	// fibonacci hashing, the high bits are the best mixed
+	uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash >> 32) & (m_entries.size() - 1);
+}
+
+size_t CPairCache::FindSlot(uint64_t key) const
+{
+	size_t mask = m_entries.size() - 1;
+	size_t slot = GetHomeSlot(key);
+
+	while (m_entries[slot].key != PAIR_CACHE_EMPTY_KEY)
+	{
+		if (m_entries[slot].key == key)
+			return slot;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return m_entries.size();
+}
+
+// Backward shift, entries after the hole are moved back when it shortens their probe
+// so that lookups never need tombstones
+void CPairCache::RemoveAt(size_t slot)
+{
+	size_t mask = m_entries.size() - 1;
+	size_t hole = slot;
+	size_t next = (hole + 1) & mask;
+
+	while (m_entries[next].key != PAIR_CACHE_EMPTY_KEY)
+	{
+		size_t home = GetHomeSlot(m_entries[next].key);
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			m_entries[hole] = m_entries[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	m_entries[hole] = SPairCacheEntry();
+	--m_count;
+}
+
+void CPairCache::Rehash(size_t capacity)
+{
+	std::vector<SPairCacheEntry> oldEntries;
+	oldEntries.swap(m_entries);
+	m_entries.resize(capacity);
+
+	size_t mask = capacity - 1;
+	for (const SPairCacheEntry& entry : oldEntries)
+	{
+		if (entry.key == PAIR_CACHE_EMPTY_KEY)
+			continue;
+
+		size_t slot = GetHomeSlot(entry.key);
+		while (m_entries[slot].key != PAIR_CACHE_EMPTY_KEY)
+			slot = (slot + 1) & mask;
+
+		m_entries[slot] = entry;
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef _PAIR_CACHE_H_
+#define _PAIR_CACHE_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "Polygon.h"
+
+#define PAIR_CACHE_EMPTY_KEY		UINT64_MAX
+#define PAIR_CACHE_MIN_CAPACITY		64
+#define PAIR_CACHE_MAX_LOAD			0.5f	// the table grows when it is fuller than this
+
+// the manifold is moved with the polygons instead of being computed again while polyB moved
+// less than this relative to polyA since the last test
+#define MANIFOLD_REFRESH_DISTANCE	0.01f
+#define MANIFOLD_REFRESH_COS_ANGLE	0.9998f	// about one degree
+
+struct SPairCacheEntry
+{
+	// (lowIndex << 32 | highIndex), PAIR_CACHE_EMPTY_KEY when the slot is free
+	uint64_t	key = PAIR_CACHE_EMPTY_KEY;
+
+	// polyA has the lowest index
+	CPolygon*	polyA = nullptr;
+	CPolygon*	polyB = nullptr;
+
+	// last frame the broadphase reported this pair
+	uint32_t	frame = 0;
+
+	// narrowphase result of the last frame
+	bool		isTouching = false;
+
+	// seeds the next GJK of this pair, the direction is for polyA against polyB
+	SGJKWarmStart	gjk;
+
+	// contact points of the last frame, matched by feature with the new ones
+	SContactPoint	manifold[MAX_CONTACT_POINTS];
+	size_t			manifoldSize = 0;
+
+	// polyB in polyA space when the manifold was last tested, the normal in polyA space
+	Vec2			relativePosition;
+	Vec2			relativeAxis;
+	Vec2			localNormal;
+};
+
+// Pairs reported by the broadphase, kept between frames in an open addressing hash table
+// (linear probing) keyed on the two polygon indices. Entries live as long as the broadphase
+// reports them, so data can be attached to a pair from one frame to the next.
+class CPairCache
+{
+public:
+	CPairCache();
+
+	void				Clear();
+	size_t				GetCount() const { return m_count; }
+
+	// starts a new frame, pairs not added again until RemoveStale are removed
+	void				BeginFrame();
+
+	// no rehash until count pairs are in the table, entries stay in place until RemoveStale
+	void				Reserve(size_t count);
+
+	// isNew is true when the pair was not in the cache last frame
+	SPairCacheEntry*	Add(CPolygon* polyA, CPolygon* polyB, bool& isNew);
+	SPairCacheEntry*	Find(size_t indexA, size_t indexB);
+
+	// calls functor(const SPairCacheEntry&) on every pair not added this frame, then removes them
+	template<typename TFunctor>
+	void				RemoveStale(TFunctor functor)
+	{
+		m_staleKeys.clear();
+		for (const SPairCacheEntry& entry : m_entries)
+		{
+			if (entry.key != PAIR_CACHE_EMPTY_KEY && entry.frame != m_frame)
+			{
+				functor(entry);
+				m_staleKeys.push_back(entry.key);
+			}
+		}
+
+		for (uint64_t key : m_staleKeys)
+		{
+			RemoveAt(FindSlot(key));
+		}
+	}
+
+	template<typename TFunctor>
+	void				ForEach(TFunctor functor)
+	{
+		for (SPairCacheEntry& entry : m_entries)
+		{
+			if (entry.key != PAIR_CACHE_EMPTY_KEY)
+				functor(entry);
+		}
+	}
+
+private:
+	size_t				GetHomeSlot(uint64_t key) const;
+	size_t				FindSlot(uint64_t key) const;
+	void				RemoveAt(size_t slot);
+	void				Rehash(size_t capacity);
+
+	std::vector<SPairCacheEntry>	m_entries;
+	size_t							m_count;
+	uint32_t						m_frame;
+
+	std::vector<uint64_t>			m_staleKeys;
+};
+
+#endif
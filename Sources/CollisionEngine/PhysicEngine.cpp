@@ -1,26 +1,89 @@
 #include "PhysicEngine.h"
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include "GlobalVariables.h"
 #include "World.h"
 #include "Renderer.h" // for debugging only
+#include "DebugDraw.h"
 #include "Timer.h"
 
 #include "BroadPhase.h"
-#include "BroadPhaseBrut.h"
-#include "BroadPhaseSAP.h"
+#include "StaticBroadPhase.h"
+#include "ThreadPool.h"
 
 
+CPhysicEngine::CPhysicEngine()
+	: m_broadPhaseType(BroadPhaseType::Auto), m_broadPhase(nullptr), m_staticBroadPhase(new CStaticBroadPhase())
+{
+}
+
+CPhysicEngine::~CPhysicEngine()
+{
+	delete m_broadPhase;
+	delete m_staticBroadPhase;
+}
+
 void	CPhysicEngine::Reset()
 {
 	m_pairsToCheck.clear();
 	m_collidingPairs.clear();
 
+	m_pairCache.Clear();
+	m_pairEntries.clear();
+	m_contactEvents.clear();
+
+	m_staticBroadPhase->Clear();
+
 	m_active = true;
 
-	m_broadPhase = new CBroadPhaseSAP();
+	delete m_broadPhase;
+	m_broadPhase = CreateBroadPhase(m_broadPhaseType);
+}
+
+void	CPhysicEngine::SetBroadPhase(BroadPhaseType type)
+{
+	m_broadPhaseType = type;
+
+	// the pair cache is kept, the new broadphase reports the same pairs
+	m_pairsToCheck.clear();
+	m_pairEntries.clear();
+
+	delete m_broadPhase;
+	m_broadPhase = CreateBroadPhase(m_broadPhaseType);
+}
+
+BroadPhaseType	CPhysicEngine::GetBroadPhaseType() const
+{
+	return m_broadPhaseType;
+}
+
+// the boxes of the polygons placed by the scene are not computed yet
+bool	CPhysicEngine::SaveStaticBVH(const std::string& path)
+{
+	gVars->pWorld->UpdateWorldSpace();
+
+	std::ofstream file(path, std::ios::binary);
+	return file && m_staticBroadPhase->SaveTree(file);
+}
+
+bool	CPhysicEngine::LoadStaticBVH(const std::string& path)
+{
+	gVars->pWorld->UpdateWorldSpace();
+
+	std::ifstream file(path, std::ios::binary);
+	return file && m_staticBroadPhase->LoadTree(file);
+}
+
+std::string	CPhysicEngine::GetBroadPhaseName() const
+{
+	std::string name = GetBroadPhaseDesc(m_broadPhaseType).name;
+
+	if (m_broadPhaseType == BroadPhaseType::Auto && m_broadPhase)
+		name += std::string(" (") + m_broadPhase->GetName() + ")";
 
+	return name;
 }
 
 void	CPhysicEngine::Activate(bool active)
@@ -30,22 +93,36 @@ void	CPhysicEngine::Activate(bool active)
 
 void	CPhysicEngine::DetectCollisions()
 {
+	// once per step, broadphases and narrowphase only read the cache
+	gVars->pWorld->UpdateWorldSpace();
+
 	CTimer timer;
 	timer.Start();
 	CollisionBroadPhase();
 	timer.Stop();
 	if (gVars->bDebug)
 	{
-		gVars->pRenderer->DisplayText("Collision broadphase duration " + std::to_string(timer.GetDuration() * 1000.0f) + " ms");
+		gVars->pRenderer->DisplayText("Collision broadphase " + GetBroadPhaseName() + " duration " + std::to_string(timer.GetDuration() * 1000.0f) + " ms");
 	}
 
+	UpdatePairCache();
+
 	timer.Start();
 	CollisionNarrowPhase();
 	timer.Stop();
 	if (gVars->bDebug)
 	{
 		gVars->pRenderer->DisplayText("Collision narrowphase duration " + std::to_string(timer.GetDuration() * 1000.0f) + " ms, collisions : " + std::to_string(m_collidingPairs.size()));
+		gVars->pRenderer->DisplayText("GJK warm start " + std::to_string((int)(m_narrowPhaseStats.GetWarmStartRate() * 100.0f)) + "%, support points per pair " + std::to_string(m_narrowPhaseStats.GetAverageSupportCount()));
+		gVars->pRenderer->DisplayText("Pairs rejected by bounding circles " + std::to_string(m_narrowPhaseStats.rejectCount) + " / " + std::to_string(m_pairsToCheck.size()));
+		if (m_batchedNarrowPhase)
+			gVars->pRenderer->DisplayText("Batched SAT (F7) separated " + std::to_string(m_narrowPhaseStats.batchSeparatedCount) + " / " + std::to_string(m_narrowPhaseStats.batchCount));
+		else
+			gVars->pRenderer->DisplayText("Batched SAT (F7) off");
+		gVars->pRenderer->DisplayText("Manifolds moved without test " + std::to_string(m_narrowPhaseStats.refreshCount) + ", contact points matched " + std::to_string(m_narrowPhaseStats.matchCount));
 	}
+
+	UpdateContactEvents();
 }
 
 void	CPhysicEngine::Step(float deltaTime)
@@ -62,42 +139,282 @@ void	CPhysicEngine::Step(float deltaTime)
 
 void	CPhysicEngine::CollisionBroadPhase()
 {
-	if (m_pairsToCheck.size() != 0)
+	m_pairsToCheck.clear();
+	m_broadPhase->GetCollidingPairsToCheck(m_pairsToCheck);
+
+	// dynamic polygons against the static ones, after the broadphase reset the AABB flags
+	m_staticBroadPhase->GetCollidingPairsToCheck(m_pairsToCheck);
+}
+
+void	CPhysicEngine::UpdatePairCache()
+{
+	m_pairCache.BeginFrame();
+
+	// no rehash while adding, entries pointers stay valid until the stale pairs are removed
+	m_pairCache.Reserve(m_pairCache.GetCount() + m_pairsToCheck.size());
+
+	m_pairEntries.clear();
+	for (const SPolygonPair& pair : m_pairsToCheck)
 	{
-		for (const SPolygonPair& pair : m_pairsToCheck)
-		{
-			pair.polyA->isCollide = false;
-			pair.polyB->isCollide = false;
-		}
+		bool isNew;
+		m_pairEntries.push_back(m_pairCache.Add(pair.polyA, pair.polyB, isNew));
 	}
+}
 
-	m_pairsToCheck.clear();
-	m_broadPhase->GetCollidingPairsToCheck(m_pairsToCheck);
+// midphase, circles around the polygons whatever their rotation
+static bool	AreBoundingCirclesOverlapping(const CPolygon& polyA, const CPolygon& polyB)
+{
+	float radiusSum = polyA.GetBoundingRadius() + polyB.GetBoundingRadius();
+	return (polyB.position - polyA.position).GetSqrLength() <= radiusSum * radiusSum;
 }
 
 void	CPhysicEngine::CollisionNarrowPhase()
 {
 	if (gVars->bDebug)
 	{
-		gVars->pRenderer->DrawLine(Vec2(-0.5, 0), Vec2(0.5, 0), 1.0, 0.0, 0);
-		gVars->pRenderer->DrawLine(Vec2(0, -0.5), Vec2(0, 0.5), 0.0, 1.0, 0);
+		gVars->pDebugDraw->DrawLine(Vec2(-0.5, 0), Vec2(0.5, 0), 1.0, 0.0, 0);
+		gVars->pDebugDraw->DrawLine(Vec2(0, -0.5), Vec2(0, 0.5), 0.0, 1.0, 0);
 	}
 
 	m_collidingPairs.clear();
-	for (const SPolygonPair& pair : m_pairsToCheck)
+	m_contactEvents.clear();
+	m_narrowPhaseStats = SNarrowPhaseStats();
+
+	SelectPairTests();
+
+	// the pairs only write to their own cache entry, the chunks keep their collisions and events apart
+	size_t chunkCount = (m_pairsToCheck.size() + NARROW_PHASE_CHUNK_SIZE - 1) / NARROW_PHASE_CHUNK_SIZE;
+	if (m_narrowPhaseChunks.size() < chunkCount)
+		m_narrowPhaseChunks.resize(chunkCount);
+
+	auto testChunk = [this](size_t chunkIndex, size_t)
+	{
+		size_t begin = chunkIndex * NARROW_PHASE_CHUNK_SIZE;
+		size_t end = Min(begin + NARROW_PHASE_CHUNK_SIZE, m_pairsToCheck.size());
+		TestPairs(begin, end, m_narrowPhaseChunks[chunkIndex]);
+	};
+
+	if (gVars->pThreadPool != nullptr)
+	{
+		gVars->pThreadPool->ParallelFor(chunkCount, testChunk);
+	}
+	else
+	{
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			testChunk(i, 0);
+		}
+	}
+
+	// merged in chunk order, whatever the thread that tested them, same order as a single loop
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const SNarrowPhaseChunk& chunk = m_narrowPhaseChunks[i];
+
+		m_collidingPairs.insert(m_collidingPairs.end(), chunk.collisions.begin(), chunk.collisions.end());
+		m_contactEvents.insert(m_contactEvents.end(), chunk.contactEvents.begin(), chunk.contactEvents.end());
+		m_narrowPhaseStats.Add(chunk.stats);
+	}
+}
+
+void	CPhysicEngine::TestPairs(size_t begin, size_t end, SNarrowPhaseChunk& chunk)
+{
+	chunk.collisions.clear();
+	chunk.contactEvents.clear();
+	chunk.stats = SNarrowPhaseStats();
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		SPairCacheEntry* entry = m_pairEntries[i];
+
+		// in the entry order, lowest index first, like the cached direction and manifold
+		SCollision collision(entry->polyA, entry->polyB);
+
+		bool wasTouching = entry->isTouching;
+		if (m_pairTests[i] == PairTest::BoundingCircles)
+		{
+			chunk.stats.rejectCount++;
+			entry->manifoldSize = 0;
+		}
+		else if (m_pairTests[i] == PairTest::SeparatingAxis)
+		{
+			chunk.stats.batchSeparatedCount++;
+			entry->manifoldSize = 0;
+		}
+		else if (RefreshManifold(*entry, collision))
+		{
+			chunk.stats.refreshCount++;
+		}
+		else
+		{
+			chunk.stats.checkCount++;
+			if (!(entry->gjk.direction == Vec2()))
+				chunk.stats.warmStartCount++;
+
+			entry->polyA->CheckCollision(*entry->polyB, collision, &entry->gjk);
+			chunk.stats.supportCount += entry->gjk.supportCount;
+
+			StoreManifold(*entry, collision, chunk.stats);
+		}
+
+		entry->isTouching = collision.manifoldSize > 0;
+
+		if (entry->isTouching)
+		{
+			chunk.collisions.push_back(collision);
+			chunk.contactEvents.push_back({ entry->polyA, entry->polyB, wasTouching ? ContactEventType::Persist : ContactEventType::Begin });
+		}
+		else if (wasTouching)
+		{
+			chunk.contactEvents.push_back({ entry->polyA, entry->polyB, ContactEventType::End });
+		}
+	}
+}
+
+// Pairs that can be rejected without a test, the small polygons that would go through SAT are
+// searched for a separating axis in batches first
+void	CPhysicEngine::SelectPairTests()
+{
+	m_pairTests.assign(m_pairsToCheck.size(), PairTest::Test);
+	m_satBatch.Clear();
+
+	for (size_t i = 0; i < m_pairsToCheck.size(); ++i)
+	{
+		const SPairCacheEntry& entry = *m_pairEntries[i];
+
+		// the AABB of rotated polygons are loose, most of these pairs would go through a whole GJK
+		if (!AreBoundingCirclesOverlapping(*entry.polyA, *entry.polyB))
+			m_pairTests[i] = PairTest::BoundingCircles;
+		else if (m_batchedNarrowPhase && CSATBatch::IsBatchable(*entry.polyA, *entry.polyB) && !CanRefreshManifold(entry))
+			m_satBatch.Add((uint32_t)i, *entry.polyA, *entry.polyB);
+	}
+
+	if (m_satBatch.GetCount() == 0)
+		return;
+
+	m_separatedPairs.clear();
+	m_satBatch.FindSeparated(m_separatedPairs);
+
+	m_narrowPhaseStats.batchCount = m_satBatch.GetCount();
+	for (uint32_t pairIndex : m_separatedPairs)
+		m_pairTests[pairIndex] = PairTest::SeparatingAxis;
+}
+
+bool	CPhysicEngine::CanRefreshManifold(const SPairCacheEntry& entry) const
+{
+	if (entry.manifoldSize == 0)
+		return false;
+
+	const CPolygon& polyA = *entry.polyA;
+	const CPolygon& polyB = *entry.polyB;
+
+	Vec2 relativePosition = polyA.InverseTransformPoint(polyB.position);
+	Vec2 relativeAxis(polyB.rotation.X | polyA.rotation.X, polyB.rotation.X | polyA.rotation.Y);
+
+	return (relativePosition - entry.relativePosition).GetSqrLength() <= MANIFOLD_REFRESH_DISTANCE * MANIFOLD_REFRESH_DISTANCE &&
+		(relativeAxis | entry.relativeAxis) >= MANIFOLD_REFRESH_COS_ANGLE;
+}
+
+// A touching pair that barely moved since its last test keeps its contact points, they follow
+// the polygons through their local positions and only their penetration is updated
+bool	CPhysicEngine::RefreshManifold(SPairCacheEntry& entry, SCollision& collision) const
+{
+	if (!CanRefreshManifold(entry))
+		return false;
+
+	const CPolygon& polyA = *entry.polyA;
+	const CPolygon& polyB = *entry.polyB;
+
+	Vec2 normal = polyA.rotation * entry.localNormal;
+
+	collision.manifoldSize = 0;
+	for (size_t i = 0; i < entry.manifoldSize; ++i)
+	{
+		SContactPoint& cached = entry.manifold[i];
+
+		Vec2 pointA = polyA.TransformPoint(cached.localPointA);
+		Vec2 pointB = polyB.TransformPoint(cached.localPointB);
+
+		cached.penetration = (pointA - pointB) | normal;
+		cached.point = (pointA + pointB) * 0.5f;
+		cached.normal = normal;
+
+		if (cached.penetration >= 0.0f)
+			collision.manifold[collision.manifoldSize++] = cached;
+	}
+
+	// all the points separated, the full test decides
+	return collision.manifoldSize > 0;
+}
+
+// New contact points take the impulse of the cached point with the same features
+void	CPhysicEngine::StoreManifold(SPairCacheEntry& entry, SCollision& collision, SNarrowPhaseStats& stats) const
+{
+	const CPolygon& polyA = *entry.polyA;
+	const CPolygon& polyB = *entry.polyB;
+
+	SContactPoint oldManifold[MAX_CONTACT_POINTS];
+	size_t oldManifoldSize = entry.manifoldSize;
+	for (size_t i = 0; i < oldManifoldSize; ++i)
+		oldManifold[i] = entry.manifold[i];
+
+	for (size_t i = 0; i < collision.manifoldSize; ++i)
 	{
-		SCollision collision;
-		collision.polyA = pair.polyA;
-		collision.polyB = pair.polyB;
+		SContactPoint& contact = collision.manifold[i];
 
-		if (pair.polyA->CheckCollision(*(pair.polyB), collision.point, collision.normal, collision.distance)) 
+		// the surface points, half the penetration away on each side
+		contact.localPointA = polyA.InverseTransformPoint(contact.point + contact.normal * (contact.penetration * 0.5f));
+		contact.localPointB = polyB.InverseTransformPoint(contact.point - contact.normal * (contact.penetration * 0.5f));
+
+		contact.normalImpulse = 0.0f;
+		for (size_t j = 0; j < oldManifoldSize; ++j)
 		{
-			pair.polyA->isCollide = true;
-			pair.polyB->isCollide = true;
+			if (oldManifold[j].featureId == contact.featureId)
+			{
+				contact.normalImpulse = oldManifold[j].normalImpulse;
+				stats.matchCount++;
+				break;
+			}
+		}
+
+		entry.manifold[i] = contact;
+	}
+	entry.manifoldSize = collision.manifoldSize;
 
-			m_collidingPairs.push_back(collision);
+	if (entry.manifoldSize > 0)
+	{
+		entry.relativePosition = polyA.InverseTransformPoint(polyB.position);
+		entry.relativeAxis = Vec2(polyB.rotation.X | polyA.rotation.X, polyB.rotation.X | polyA.rotation.Y);
+		entry.localNormal = polyA.rotation.GetInverse() * collision.manifold[0].normal;
+	}
+}
+
+void	CPhysicEngine::UpdateContactEvents()
+{
+	// pairs the broadphase stopped reporting
+	m_pairCache.RemoveStale([&](const SPairCacheEntry& entry)
+	{
+		if (entry.isTouching)
+			m_contactEvents.push_back({ entry.polyA, entry.polyB, ContactEventType::End });
+	});
+	m_pairEntries.clear();
+
+	// only the changes need to touch the flags
+	for (const SContactEvent& contactEvent : m_contactEvents)
+	{
+		if (contactEvent.type == ContactEventType::End)
+		{
+			contactEvent.polyA->isCollide = false;
+			contactEvent.polyB->isCollide = false;
+		}
+	}
+	for (const SContactEvent& contactEvent : m_contactEvents)
+	{
+		if (contactEvent.type != ContactEventType::End)
+		{
+			contactEvent.polyA->isCollide = true;
+			contactEvent.polyB->isCollide = true;
 		}
-		
 	}
 }
 
@@ -110,93 +427,164 @@ void CPhysicEngine::ResponseCollisions(float deltaTime)
 	float elasticity = 0.1f;
 	float damping = 0.2f;
 
-	for (const SCollision& pair : m_collidingPairs)
+	for (SCollision& pair : m_collidingPairs)
 	{
 		float invMassA = pair.polyA->density == 0 ? 0.0f : 1.0f / (pair.polyA->density );
 		float invMassB = pair.polyB->density == 0 ? 0.0f : 1.0f / (pair.polyB->density );
 		float invMassAB = invMassA + invMassB;
 
-		// rotation utility
-		Vec2 rA = pair.point - pair.polyA->position, 
-			rB = pair.point - pair.polyB->position;
-		
-		Vec2 vAi = pair.polyA->speed + Vec2::Cross(pair.polyA->angularVelocity, rA), 
-			vBi = pair.polyB->speed + Vec2::Cross(pair.polyB->angularVelocity, rB);
-		
-		float invTensorA = 1.0f / pair.polyA->GetInertiaTensor(),
-			invTensorB = 1.0f / pair.polyB->GetInertiaTensor();
+		// static polygons do not turn either
+		float invTensorA = invMassA == 0.0f ? 0.0f : 1.0f / pair.polyA->GetInertiaTensor(),
+			invTensorB = invMassB == 0.0f ? 0.0f : 1.0f / pair.polyB->GetInertiaTensor();
 
-		float momentumA = invTensorA * (rA ^ pair.normal),
-			momentumB = invTensorB * (rB ^ pair.normal);
-		
-		float weightRotA = (Vec2::Cross(momentumA, rA) | pair.normal), 
-			weightRotB = (Vec2::Cross(momentumB, rB) | pair.normal);
+		float maxPenetration = 0.0f;
+		for (size_t i = 0; i < pair.manifoldSize; ++i)
+		{
+			SContactPoint& contact = pair.manifold[i];
+			const Vec2& normal = contact.normal;
+			Vec2 tangent(-normal.y, normal.x);
 
+			maxPenetration = Max(maxPenetration, contact.penetration);
 
-		Vec2 relSpeed = (pair.polyB->speed - pair.polyA->speed);
+			// rotation utility
+			Vec2 rA = contact.point - pair.polyA->position, 
+				rB = contact.point - pair.polyB->position;
 
-		//impulsion 
-		float impulse = 0.0f;
-		{
-			float relSpeedNorm = relSpeed | (-pair.normal);
+			float momentumA = invTensorA * (rA ^ normal),
+				momentumB = invTensorB * (rB ^ normal);
 
-			if (relSpeedNorm > 0)
+			float weightRotA = (Vec2::Cross(momentumA, rA) | normal), 
+				weightRotB = (Vec2::Cross(momentumB, rB) | normal);
+
+			// speed of the contact point on each polygon, before the warm start
+			Vec2 vAi = pair.polyA->speed + Vec2::Cross(pair.polyA->angularVelocity, rA), 
+				vBi = pair.polyB->speed + Vec2::Cross(pair.polyB->angularVelocity, rB);
+
+			// restitution of the approach speed only, not of the speed given back by the warm start
+			float approachSpeed = (vBi - vAi) | normal;
+			float bounce = approachSpeed < 0.0f ? -elasticity * approachSpeed : 0.0f;
+
+			auto applyImpulse = [&](const Vec2& impulse)
 			{
-				float elasticFactor = -(elasticity + 1.0f);
+				pair.polyA->speed -= impulse * invMassA;
+				pair.polyB->speed += impulse * invMassB;
+				pair.polyA->angularVelocity -= invTensorA * (rA ^ impulse);
+				pair.polyB->angularVelocity += invTensorB * (rB ^ impulse);
+			};
 
-				bool rotationOn = true;
+			// warm start, the impulse this point needed last frame
+			applyImpulse(normal * contact.normalImpulse);
 
-				impulse = (elasticFactor * relSpeedNorm) / (invMassAB);
+			vAi = pair.polyA->speed + Vec2::Cross(pair.polyA->angularVelocity, rA);
+			vBi = pair.polyB->speed + Vec2::Cross(pair.polyB->angularVelocity, rB);
+			Vec2 relSpeed = vBi - vAi;
 
-				if(rotationOn)
-					impulse = (elasticFactor * relSpeedNorm) / (invMassAB+ weightRotA + weightRotB);
+			//impulsion, accumulated so it never pulls the polygons together
+			float impulse = -((relSpeed | normal) - bounce) / (invMassAB + weightRotA + weightRotB);
+			float normalImpulse = Max(contact.normalImpulse + impulse, 0.0f);
+			impulse = normalImpulse - contact.normalImpulse;
+			contact.normalImpulse = normalImpulse;
 
-				pair.polyA->speed += (pair.normal) * impulse * invMassA;
-				pair.polyB->speed -= (pair.normal) * impulse * invMassB;
+			applyImpulse(normal * impulse);
 
-				if (rotationOn)
-				{
-					pair.polyA->angularVelocity +=  impulse * momentumA;
-					pair.polyB->angularVelocity -=  impulse * momentumB;
-				}
-				
-			}
+			// friction 
+			vAi = pair.polyA->speed + Vec2::Cross(pair.polyA->angularVelocity, rA);
+			vBi = pair.polyB->speed + Vec2::Cross(pair.polyB->angularVelocity, rB);
+			relSpeed = vBi - vAi;
+
+			float tangentMomentumA = invTensorA * (rA ^ tangent),
+				tangentMomentumB = invTensorB * (rB ^ tangent);
+			float tangentWeight = invMassAB + (Vec2::Cross(tangentMomentumA, rA) | tangent) + (Vec2::Cross(tangentMomentumB, rB) | tangent);
+
+			float maxFriction = normalImpulse * frictionFactor;
+			float friction = Clamp(-(relSpeed | tangent) / tangentWeight, -maxFriction, maxFriction);
+
+			applyImpulse(tangent * friction);
 		}
 
-		//position correction 
+		//position correction, once for the pair
+		if (invMassAB > 0.0f)
 		{
-			{
-				float correction = (pair.distance * damping) / (invMassAB);
+			float correction = (maxPenetration * damping) / (invMassAB);
 
-				pair.polyA->position -= pair.normal * invMassA * correction;
-				pair.polyB->position += pair.normal * invMassB * correction;
-			}
+			pair.polyA->position -= pair.manifold[0].normal * invMassA * correction;
+			pair.polyB->position += pair.manifold[0].normal * invMassB * correction;
 		}
 
-		// friction 
-		if (relSpeed.GetSqrLength() > 0.0f)
+		// kept for the warm start of the next frame
+		SPairCacheEntry* entry = m_pairCache.Find(pair.polyA->GetIndex(), pair.polyB->GetIndex());
+		if (entry)
 		{
-			Vec2 tangent = ((pair.normal) + relSpeed.Normalized());
-
-			if (tangent.GetSqrLength() != 0.0f)
+			for (size_t i = 0; i < pair.manifoldSize; ++i)
 			{
-				float friction = Clamp(-(relSpeed | tangent.Normalized()) / invMassAB, -std::abs(impulse) * frictionFactor, std::abs(impulse) * frictionFactor);
-				pair.polyA->speed -= tangent * friction * invMassA;
-				pair.polyB->speed += tangent * friction * invMassB;
+				for (size_t j = 0; j < entry->manifoldSize; ++j)
+				{
+					if (entry->manifold[j].featureId == pair.manifold[i].featureId)
+						entry->manifold[j].normalImpulse = pair.manifold[i].normalImpulse;
+				}
 			}
-
 		}
 	}
 
 
+	ComputeBulletImpacts(deltaTime);
+
 	gVars->pWorld->ForEachPolygon([&](CPolygonPtr poly)
 	{
 		if (poly->density == 0.0f)
 			return;
 
-		poly->rotation.Rotate(RAD2DEG(poly->angularVelocity * deltaTime));
-		poly->position += poly->speed * deltaTime;
+		// a bullet stops at its impact, the discrete test takes the contact next step
+		float moveTime = deltaTime * m_impactFractions[poly->GetIndex()];
+
+		poly->rotation.Rotate(RAD2DEG(poly->angularVelocity * moveTime));
+		poly->position += poly->speed * moveTime;
 		poly->speed += gravity * deltaTime;
 	});
 
+	if (gVars->bDebug)
+	{
+		gVars->pRenderer->DisplayText("Bullets stopped at their time of impact " + std::to_string(m_bulletImpactCount));
+	}
+
+}
+
+// swept midphase, the bounding circle of the obstacle against the one of the bullet moving along its relative displacement
+static bool	CanSweepHit(const CPolygon& bullet, const CPolygon& obstacle, float deltaTime)
+{
+	Vec2 obstacleSpeed = obstacle.IsStatic() ? Vec2() : obstacle.speed;
+	Vec2 displacement = (bullet.speed - obstacleSpeed) * deltaTime;
+	Vec2 toObstacle = obstacle.position - bullet.position;
+
+	float sqrLength = displacement.GetSqrLength();
+	float t = sqrLength > 0.0f ? Clamp((toObstacle | displacement) / sqrLength, 0.0f, 1.0f) : 0.0f;
+
+	float radiusSum = bullet.GetBoundingRadius() + obstacle.GetBoundingRadius();
+	return (toObstacle - displacement * t).GetSqrLength() <= radiusSum * radiusSum;
+}
+
+void	CPhysicEngine::ComputeBulletImpacts(float deltaTime)
+{
+	m_impactFractions.assign(gVars->pWorld->GetPolygonCount(), 1.0f);
+	m_bulletImpactCount = 0;
+
+	// few bullets, every polygon is an obstacle
+	gVars->pWorld->ForEachPolygon([&](CPolygonPtr bullet)
+	{
+		if (!bullet->isBullet || bullet->IsStatic())
+			return;
+
+		float& fraction = m_impactFractions[bullet->GetIndex()];
+
+		gVars->pWorld->ForEachPolygon([&](CPolygonPtr obstacle)
+		{
+			if (obstacle == bullet || !CanSweepHit(*bullet, *obstacle, deltaTime))
+				return;
+
+			fraction = Min(fraction, m_timeOfImpact.Compute(*bullet, *obstacle, deltaTime));
+		});
+
+		if (fraction < 1.0f)
+			m_bulletImpactCount++;
+	});
 }
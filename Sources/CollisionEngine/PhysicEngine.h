@@ -2,39 +2,120 @@
 #define _PHYSIC_ENGINE_H_
 
 #include <vector>
+#include <string>
 #include <unordered_map>
 #include "Maths.h"
 #include "Polygon.h"
+#include "PairCache.h"
+#include "SATBatch.h"
+#include "TimeOfImpact.h"
 
 class IBroadPhase;
+class CStaticBroadPhase;
+enum class BroadPhaseType : int;
 
+// the world keeps the polygons alive, no need to pay for shared pointers copies
 struct SPolygonPair
 {
-	SPolygonPair(CPolygonPtr _polyA, CPolygonPtr _polyB) : polyA(_polyA), polyB(_polyB){}
+	SPolygonPair(CPolygon* _polyA, CPolygon* _polyB) : polyA(_polyA), polyB(_polyB){}
 
-	CPolygonPtr	polyA;
-	CPolygonPtr	polyB;
+	CPolygon*	polyA;
+	CPolygon*	polyB;
 };
 
 struct SCollision
 {
 	SCollision() = default;
-	SCollision(CPolygonPtr _polyA, CPolygonPtr _polyB, Vec2	_point, Vec2 _normal, float _distance)
-		: polyA(_polyA), polyB(_polyB), point(_point), normal(_normal), distance(_distance){}
+	SCollision(CPolygon* _polyA, CPolygon* _polyB)
+		: polyA(_polyA), polyB(_polyB){}
 
-	CPolygonPtr	polyA, polyB;
+	CPolygon*	polyA = nullptr;
+	CPolygon*	polyB = nullptr;
 
-	Vec2	point;
-	Vec2	normal;
-	float	distance;
+	// normals go from polyA to polyB
+	SContactPoint	manifold[MAX_CONTACT_POINTS];
+	size_t			manifoldSize = 0;
+};
+
+enum class ContactEventType
+{
+	Begin,		// touching this frame, not the previous one
+	Persist,	// touching this frame and the previous one
+	End,		// touching the previous frame, not this one
+};
+
+// what the narrowphase does with a pair, decided before the pairs are tested one by one
+enum class PairTest : uint8_t
+{
+	Test,				// manifold refreshed or full test
+	BoundingCircles,	// bounding circles apart
+	SeparatingAxis,		// separated, found by the batched search
+};
+
+struct SContactEvent
+{
+	CPolygon*			polyA;
+	CPolygon*			polyB;
+	ContactEventType	type;
+};
+
+// Narrowphase figures of the last step
+struct SNarrowPhaseStats
+{
+	size_t	checkCount = 0;		// pairs tested
+	size_t	rejectCount = 0;	// pairs whose bounding circles do not overlap, not tested
+	size_t	batchCount = 0;		// pairs that went through the batched separating axis search
+	size_t	batchSeparatedCount = 0;	// of these, the separated ones, not tested
+	size_t	warmStartCount = 0;	// pairs with a direction from the previous frame
+	size_t	supportCount = 0;	// support points evaluated
+	size_t	refreshCount = 0;	// touching pairs that barely moved, manifold moved without a test
+	size_t	matchCount = 0;		// contact points found again with the same features
+
+	void	Add(const SNarrowPhaseStats& other)
+	{
+		checkCount += other.checkCount;
+		rejectCount += other.rejectCount;
+		batchCount += other.batchCount;
+		batchSeparatedCount += other.batchSeparatedCount;
+		warmStartCount += other.warmStartCount;
+		supportCount += other.supportCount;
+		refreshCount += other.refreshCount;
+		matchCount += other.matchCount;
+	}
+
+	float	GetWarmStartRate() const { return checkCount ? (float)warmStartCount / (float)checkCount : 0.0f; }
+	float	GetAverageSupportCount() const { return checkCount ? (float)supportCount / (float)checkCount : 0.0f; }
+};
+
+#define NARROW_PHASE_CHUNK_SIZE	64	// pairs per task of the parallel narrowphase
+
+// collisions and events found by one task of the narrowphase, merged in order afterwards
+struct SNarrowPhaseChunk
+{
+	std::vector<SCollision>		collisions;
+	std::vector<SContactEvent>	contactEvents;
+	SNarrowPhaseStats			stats;
 };
 
 class CPhysicEngine
 {
 public:
+	CPhysicEngine();
+	~CPhysicEngine();
+
 	void	Reset();
 	void	Activate(bool active);
 
+	// takes effect immediately and is kept when the scene is reset
+	void			SetBroadPhase(BroadPhaseType type);
+	BroadPhaseType	GetBroadPhaseType() const;
+	std::string		GetBroadPhaseName() const;
+
+	// BVH of the static polygons of the scene, saved once and loaded with the scene
+	// so that it is not built at load time. Load returns false if the file does not match the scene.
+	bool			SaveStaticBVH(const std::string& path);
+	bool			LoadStaticBVH(const std::string& path);
+
 	void	DetectCollisions();
 	void	ResponseCollisions(float deltaTime);
 
@@ -50,19 +131,68 @@ public:
 		}
 	}
 
+	const SNarrowPhaseStats&	GetNarrowPhaseStats() const { return m_narrowPhaseStats; }
+
+	// small polygon pairs first go through a separating axis search run on several pairs at once (SIMD),
+	// only the touching ones are then tested one by one
+	void	SetBatchedNarrowPhase(bool batched) { m_batchedNarrowPhase = batched; }
+	bool	IsBatchedNarrowPhase() const { return m_batchedNarrowPhase; }
+
+	// contacts that began, persisted or ended during the last step
+	template<typename TFunctor>
+	void	ForEachContactEvent(TFunctor functor)
+	{
+		for (const SContactEvent& contactEvent : m_contactEvents)
+		{
+			functor(contactEvent);
+		}
+	}
+
 private:
 	friend class CPenetrationVelocitySolver;
 
 	void						CollisionBroadPhase();
+	void						UpdatePairCache();
 	void						CollisionNarrowPhase();
+	void						UpdateContactEvents();
+
+	void						SelectPairTests();
+	void						TestPairs(size_t begin, size_t end, SNarrowPhaseChunk& chunk);
+	bool						CanRefreshManifold(const SPairCacheEntry& entry) const;
+	bool						RefreshManifold(SPairCacheEntry& entry, SCollision& collision) const;
+	void						StoreManifold(SPairCacheEntry& entry, SCollision& collision, SNarrowPhaseStats& stats) const;
+	void						ComputeBulletImpacts(float deltaTime);
 
 	bool						m_active = true;
 
 	// Collision detection
+	BroadPhaseType				m_broadPhaseType;
 	IBroadPhase*				m_broadPhase;
+	CStaticBroadPhase*			m_staticBroadPhase;
 	std::vector<SPolygonPair>	m_pairsToCheck;
 	std::vector<SCollision>		m_collidingPairs;
 
+	// persistent pairs, m_pairEntries[i] is the entry of m_pairsToCheck[i]
+	CPairCache					m_pairCache;
+	std::vector<SPairCacheEntry*>	m_pairEntries;
+	std::vector<SContactEvent>	m_contactEvents;
+
+	SNarrowPhaseStats			m_narrowPhaseStats;
+
+	// m_pairTests[i] is for m_pairsToCheck[i]
+	bool						m_batchedNarrowPhase = false;
+	std::vector<PairTest>		m_pairTests;
+	CSATBatch					m_satBatch;
+	std::vector<uint32_t>		m_separatedPairs;
+
+	// one per NARROW_PHASE_CHUNK_SIZE pairs, kept to reuse their buffers
+	std::vector<SNarrowPhaseChunk>	m_narrowPhaseChunks;
+
+	// continuous collision of the bullets, m_impactFractions[polygon index] is the part of the step it moves
+	CTimeOfImpact				m_timeOfImpact;
+	std::vector<float>			m_impactFractions;
+	size_t						m_bulletImpactCount = 0;
+
 };
 
 #endif
\ No newline at end of file
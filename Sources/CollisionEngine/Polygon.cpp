@@ -4,9 +4,10 @@
 #include <string>
 
 #include "GlobalVariables.h"
-#include "Renderer.h" 
+#include "DebugDraw.h"
 
 #include "PhysicEngine.h"
+#include "ShapeCollision.h"
 
 CPolygon::CPolygon(size_t index)
 	: m_vertexBufferId(0), m_index(index), density(0.1f)
@@ -23,12 +24,29 @@ void CPolygon::Build()
 {
 	m_lines.clear();
 	
-	ComputeArea();
-	RecenterOnCenterOfMass();
-	ComputeLocalInertiaTensor();
+	if (IsRound())
+	{
+		BuildRound();
+	}
+	else
+	{
+		ComputeArea();
+		RecenterOnCenterOfMass();
+		ComputeLocalInertiaTensor();
+	}
+
+	ComputeBoundingRadius();
+
+	// points changed, the vertex buffer is created again on next draw
+	DestroyBuffers();
+
+	// a single point has no edge
+	if (shape != ShapeType::Circle)
+		BuildLines();
 
-	CreateBuffers();
-	BuildLines();
+	// static polygons keep this one until they are moved
+	m_isWorldSpaceValid = false;
+	UpdateWorldSpace();
 }
 
 void CPolygon::Draw()
@@ -46,9 +64,13 @@ void CPolygon::Draw()
 	glPushMatrix();
 	glMultMatrixf(transfMat);
 
+	// created on first draw, so that polygons can live without GL context
+	if (m_vertexBufferId == 0)
+		CreateBuffers();
+
 	// Draw vertices
 	BindBuffers();
-	glDrawArrays(GL_LINE_LOOP, 0, points.size());
+	glDrawArrays(GL_LINE_LOOP, 0, m_vertexBufferSize);
 	glDisableClientState(GL_VERTEX_ARRAY);
 
 	glPopMatrix();
@@ -74,12 +96,24 @@ Vec2	CPolygon::InverseTransformPoint(const Vec2& point) const
 
 bool	CPolygon::IsPointInside(const Vec2& point) const
 {
+	if (IsRound())
+	{
+		// distance to the segment (or the center)
+		Vec2 closest = m_worldPoints.front();
+		if (shape == ShapeType::Capsule)
+		{
+			Vec2 axis = m_worldPoints[1] - m_worldPoints[0];
+			float t = Clamp(((point - m_worldPoints[0]) | axis) / axis.GetSqrLength(), 0.0f, 1.0f);
+			closest = m_worldPoints[0] + axis * t;
+		}
+		return (point - closest).GetSqrLength() <= radius * radius;
+	}
+
 	float maxDist = -FLT_MAX;
 
-	for (const Line& line : m_lines)
+	for (size_t i = 0; i < m_worldPoints.size(); ++i)
 	{
-		Line globalLine = line.Transform(rotation, position);
-		float pointDist = globalLine.GetPointDist(point);
+		float pointDist = (point - m_worldPoints[i]) | m_worldNormals[i];
 		maxDist = Max(maxDist, pointDist);
 	}
 
@@ -90,18 +124,22 @@ void CPolygon::CreateBuffers()
 {
 	DestroyBuffers();
 
-	float* vertices = new float[3 * points.size()];
-	for (size_t i = 0; i < points.size(); ++i)
+	std::vector<Vec2> outline;
+	GetOutline(outline);
+	m_vertexBufferSize = outline.size();
+
+	float* vertices = new float[3 * outline.size()];
+	for (size_t i = 0; i < outline.size(); ++i)
 	{
-		vertices[3 * i] = points[i].x;
-		vertices[3 * i + 1] = points[i].y;
+		vertices[3 * i] = outline[i].x;
+		vertices[3 * i + 1] = outline[i].y;
 		vertices[3 * i + 2] = 0.0f;
 	}
 
 	glGenBuffers(1, &m_vertexBufferId);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * points.size(), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * outline.size(), vertices, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -141,48 +179,115 @@ void CPolygon::BuildLines()
 	}
 }
 
-bool CPolygon::IsMovingPositionAndRotation()
+// points are around position once the polygon is centered, round shapes add their radius
+void CPolygon::ComputeBoundingRadius()
 {
-	return ((savePosition.x != position.x && savePosition.y != position.y) ||
-		   ((saveRotation.X.x != rotation.X.x && saveRotation.X.y != rotation.X.y) &&
-			(saveRotation.Y.x != rotation.Y.x && saveRotation.Y.y != rotation.Y.y)));
+	float maxSqrLength = 0.0f;
+	for (const Vec2& point : points)
+		maxSqrLength = Max(maxSqrLength, point.GetSqrLength());
+
+	m_boundingRadius = sqrtf(maxSqrLength) + radius;
 }
 
-void CPolygon::DrawAABB()
+// Circles and capsules have exact area and inertia, their points are already centered
+void CPolygon::BuildRound()
 {
-	if(boxAABB.isCollide)
-		glColor3f(0.0f, 1.0f, 0.0f);
-	else
-		glColor3f(1.0f, 0.0f, 0.0f);
+	float circleArea = (float)M_PI * radius * radius;
 
-	if (IsMovingPositionAndRotation())
+	if (shape == ShapeType::Circle)
 	{
-		std::vector<Vec2> newPoints;
+		m_signedArea = circleArea;
+		m_localInertiaTensor = 0.5f * radius * radius;
+		return;
+	}
 
-		for (Vec2 point : points)
-			newPoints.push_back(rotation * point);	
+	// box between the two half disks, the half disks together make a disk
+	float length = (points[1] - points[0]).GetLength();
+	float boxArea = 2.0f * radius * length;
 
-		boxAABB.Build(newPoints,position);
-	}
+	float boxInertia = boxArea * (length * length + 4.0f * radius * radius) / 12.0f;
+	float disksInertia = circleArea * (0.5f * radius * radius + 0.25f * length * length + length * radius * 4.0f / (3.0f * (float)M_PI));
 
-	boxAABB.Draw(position);
+	m_signedArea = boxArea + circleArea;
+	m_localInertiaTensor = (boxInertia + disksInertia) / m_signedArea;
+}
+
+void CPolygon::GetOutline(std::vector<Vec2>& outline) const
+{
+	if (!IsRound())
+	{
+		outline = points;
+		return;
+	}
 
-	savePosition = position;
-	saveRotation = rotation;
+	// half circle around each end of the segment, a single point for a circle
+	const size_t halfSides = 16;
+	for (size_t end = 0; end < points.size(); ++end)
+	{
+		Vec2 axis = (shape == ShapeType::Capsule) ? (points[end] - points[1 - end]).Normalized() : Vec2(1.0f, 0.0f);
+		size_t sides = (shape == ShapeType::Capsule) ? halfSides : 2 * halfSides;
 
-	glColor3f(0.0f, 0.0f, 0.0f);
+		for (size_t i = 0; i <= sides; ++i)
+		{
+			if (shape == ShapeType::Circle && i == sides)
+				break;
 
+			float angle = (float)M_PI * ((float)i / (float)halfSides - 0.5f);
+			outline.push_back(points[end] + (axis * cosf(angle) + axis.GetNormal() * sinf(angle)) * radius);
+		}
+	}
 }
 
-Vec2 CPolygon::GetWolrdMinAABB()
+void CPolygon::DrawAABB()
 {
-	return boxAABB.minPoint + position;
+	if(boxAABB.isCollide)
+		glColor3f(0.0f, 1.0f, 0.0f);
+	else
+		glColor3f(1.0f, 0.0f, 0.0f);
+
+	// may have moved since the step
+	UpdateWorldSpace();
+	boxAABB.Draw(m_worldAABB);
+
+	glColor3f(0.0f, 0.0f, 0.0f);
+
 }
-Vec2 CPolygon::GetWolrdMaxAABB()
+
+void CPolygon::UpdateWorldSpace()
 {
-	return boxAABB.maxPoint + position;
-}
+	if (m_isWorldSpaceValid && m_worldPosition == position &&
+		m_worldRotation.X == rotation.X && m_worldRotation.Y == rotation.Y)
+		return;
 
+	m_worldPosition = position;
+	m_worldRotation = rotation;
+	m_isWorldSpaceValid = true;
+
+	// resize does not allocate once the polygon went through its first update
+	m_worldPoints.resize(points.size());
+	m_worldNormals.resize(m_lines.size());
+
+	if (points.empty())
+	{
+		m_worldAABB = AABB(position, position);
+		return;
+	}
+
+	m_worldAABB = AABB(TransformPoint(points.front()), TransformPoint(points.front()));
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		m_worldPoints[i] = TransformPoint(points[i]);
+		m_worldAABB.Extend(m_worldPoints[i]);
+	}
+
+	m_worldAABB.minPoint -= Vec2(radius, radius);
+	m_worldAABB.maxPoint += Vec2(radius, radius);
+
+	for (size_t i = 0; i < m_lines.size(); ++i)
+	{
+		m_worldNormals[i] = rotation * m_lines[i].GetNormal();
+	}
+}
 
 
 
@@ -196,24 +301,69 @@ Vec2 CPolygon::GetWolrdMaxAABB()
 
 Vec2 CPolygon::FindFurthestPoint(Vec2 direction) const
 {
-	Vec2 maxPoint;
-	float maxDistance = -FLT_MAX;
+	size_t hint = 0;
+	return FindFurthestPoint(direction, hint);
+}
 
-	for (Vec2 vertex : points)
-	{
-		vertex = TransformPoint(vertex);
+Vec2 CPolygon::FindFurthestPoint(const Vec2& direction, size_t& hint) const
+{
+	hint = FindFurthestPointIndex(direction, hint);
+
+	if (radius > 0.0f)
+		return m_worldPoints[hint] + direction.Normalized() * radius;
+	return m_worldPoints[hint];
+}
+
+// The polygon is convex, the distance along the direction only grows then shrinks around the
+// vertex ring : walk from the hint towards the neighbour going further until it stops growing.
+// Starting from last call vertex, it is a few steps at most. Collinear vertices make flat runs,
+// a hint inside one cannot tell the top from the bottom, it falls back to a linear scan.
+size_t CPolygon::FindFurthestPointIndex(const Vec2& direction, size_t hint) const
+{
+	const std::vector<Vec2>& worldPoints = m_worldPoints;
+
+	size_t count = worldPoints.size();
+	size_t index = (hint < count) ? hint : 0;
+	float distance = worldPoints[index] | direction;
 
-		float distance = vertex | direction;
-		
+	size_t next = (index + 1 == count) ? 0 : index + 1;
+	size_t prev = (index == 0) ? count - 1 : index - 1;
 
-		if (distance > maxDistance)
+	float nextDistance = worldPoints[next] | direction;
+	float prevDistance = worldPoints[prev] | direction;
+
+	bool forward;
+	if (nextDistance > distance)
+		forward = true;
+	else if (prevDistance > distance)
+		forward = false;
+	else if (nextDistance < distance && prevDistance < distance)
+		return index;
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
 		{
-			maxDistance = distance;
-			maxPoint = vertex;
+			float pointDistance = worldPoints[i] | direction;
+			if (pointDistance > distance)
+			{
+				index = i;
+				distance = pointDistance;
+			}
 		}
+		return index;
 	}
 
-	return maxPoint;
+	// strictly growing, so at most count steps
+	while (true)
+	{
+		size_t candidate = forward ? ((index + 1 == count) ? 0 : index + 1) : ((index == 0) ? count - 1 : index - 1);
+		float candidateDistance = worldPoints[candidate] | direction;
+		if (candidateDistance <= distance)
+			return index;
+
+		index = candidate;
+		distance = candidateDistance;
+	}
 }
 
 void CPolygon::ComputeArea()
@@ -372,6 +522,11 @@ bool CPolygon::CheckSimplexTriangle(Simplex& simplexPoints, Vec2& direction) con
 }
 
 
+Vec2 GetPointGJK( const CPolygon& polyA, const CPolygon& polyB, Vec2 direction, size_t& hintA, size_t& hintB)
+{
+	return polyA.FindFurthestPoint(direction, hintA) - polyB.FindFurthestPoint(-direction, hintB);
+}
+
 Vec2 GetPointGJK( const CPolygon& polyA, const CPolygon& polyB, Vec2 direction)
 {
 	return polyA.FindFurthestPoint(direction) - polyB.FindFurthestPoint(-direction);
@@ -429,30 +584,64 @@ float CPolygon::GetDistanceAndNormal(Simplex& simplexPoints, Vec2& norm) const
 
 	if (gVars->bDebug)
 	{
-		gVars->pRenderer->DrawLine(Vec2(0, 0), norm * 5, 0.0, 2.0, 0.0);
-		gVars->pRenderer->DisplayTextWorld("distance : " + std::to_string(distance), minPoint);
+		gVars->pDebugDraw->DrawLine(Vec2(0, 0), norm * 5, 0.0, 2.0, 0.0);
+		gVars->pDebugDraw->DrawLabel(DebugLabel::Distance, distance, minPoint);
 	}
 
 	return distance ;
 
 }
 
-bool	CPolygon::CheckCollision(const CPolygon& poly, Vec2& colPoint, Vec2& colNormal, float& colDist) const
+bool	CPolygon::CheckCollision(const CPolygon& poly, SCollision& collision, SGJKWarmStart* warmStart) const
 {
-	// narrow phase 
-	 
-	Vec2 direction = Vec2(1, 0);
+	// narrow phase, the test registered for the two shape types
+
+	if (warmStart)
+		warmStart->supportCount = 0;
+
+	collision.manifoldSize = CollideShapes(*this, poly, collision.manifold, warmStart);
+	return collision.manifoldSize > 0;
+}
+
+size_t	CPolygon::CollideGJK(const CPolygon& poly, SContactPoint* contacts, SGJKWarmStart* warmStart) const
+{
+	// last frame direction, a separating axis stays one for a while
+	bool warm = warmStart && !(warmStart->direction == Vec2());
+	Vec2 direction = warm ? warmStart->direction : Vec2(1, 0);
+	int supportCount = 0;
+
+	// support vertices climb from the ones of the previous call
+	size_t hintA = warmStart ? warmStart->supportA : 0;
+	size_t hintB = warmStart ? warmStart->supportB : 0;
+
+	auto finish = [&](size_t contactCount)
+	{
+		if (warmStart)
+		{
+			warmStart->direction = direction;
+			warmStart->supportA = hintA;
+			warmStart->supportB = hintB;
+			warmStart->supportCount = supportCount;
+		}
+		return contactCount;
+	};
 
 	Simplex simp;
 
-	simp.push_front(GetPointGJK(*this, poly, direction));
+	simp.push_front(GetPointGJK(*this, poly, direction, hintA, hintB));
+	++supportCount;
+
+	// the whole minkowski difference is behind the origin
+	if ((simp[0] | direction) < 0.0f)
+		return finish(0);
 
 	direction = -simp[0];
 
-	Vec2 newSimplexPoint = GetPointGJK(*this, poly, direction);
+	Vec2 newSimplexPoint = GetPointGJK(*this, poly, direction, hintA, hintB);
+	++supportCount;
 	
 	if ((newSimplexPoint.Normalized() | direction.Normalized()) <= 0)
-		return false;
+		return finish(0);
 
 	simp.push_front(newSimplexPoint);
 
@@ -471,35 +660,33 @@ bool	CPolygon::CheckCollision(const CPolygon& poly, Vec2& colPoint, Vec2& colNor
 
 	for (int i = 0; i < maxIter; i++)
 	{
-		newSimplexPoint = GetPointGJK(*this, poly, direction);
+		newSimplexPoint = GetPointGJK(*this, poly, direction, hintA, hintB);
+		++supportCount;
 
 		if ((newSimplexPoint.Normalized() | direction.Normalized()) <= 0)
-			return false;
+			return finish(0);
 
 		simp.push_front(newSimplexPoint);
 
 
 		if (CheckSimplexTriangle(simp, direction))
 		{
-			SCollision coliderInfo = EPA(simp, poly);
-
-			colDist = coliderInfo.distance;
-			colNormal = coliderInfo.normal;
-			colPoint = coliderInfo.point;
+			SContactPoint& contact = contacts[0];
+			contact = EPA(simp, poly, hintA, hintB);
 
 			if (gVars->bDebug)
 			{
-				gVars->pRenderer->DrawLine(this->position, colNormal * 5.f, 2, 0, 0);
-				gVars->pRenderer->DrawLine(this->position, colPoint, 2, 2, 0);
+				gVars->pDebugDraw->DrawLine(this->position, contact.normal * 5.f, 2, 0, 0);
+				gVars->pDebugDraw->DrawLine(this->position, contact.point, 2, 2, 0);
 			}
 
 
-			return true;
+			return finish(1);
 		}
 	}
 
 	
-	return false;
+	return finish(0);
 }
 
 #pragma endregion
@@ -555,68 +742,42 @@ void CPolygon::GetInfoCollisionWithEPA(Simplex& simp, const CPolygon& shapeA, co
 
 }
 
-SCollision  CPolygon::EPA(const Simplex& simplex, const CPolygon& poly) const
+SContactPoint  CPolygon::EPA(const Simplex& simplex, const CPolygon& poly, size_t& hintA, size_t& hintB) const
 {
-	int minInd = 0;
-	Vec2 minNormal;
-	float minDist = FLT_MAX;
-	std::vector<Vec2> polytope(simplex.m_points.begin(), simplex.m_points.end());
-
-	int maxIter = 32;
-	for(int i = 0; i < maxIter; i++ )
-	{
-		for (int i = 0; i < polytope.size(); i++)
-		{
-			Vec2 a = polytope[i];
-			Vec2 b = polytope[(i + 1) % polytope.size()];
+	SPolytope polytope;
+	polytope.Init(simplex.m_points[0], simplex.m_points[1], simplex.m_points[2]);
 
-			Vec2 ab = b - a;
+	if (polytope.IsEmpty())
+		return SContactPoint{};
 
-			Vec2 normal = (Vec2(ab.y, -ab.x)).Normalized();
+	Vec2 minNormal = polytope.GetClosestEdge().normal;
+	float minDist = polytope.GetClosestEdge().distance;
 
-			float distance = normal | a;
-
-			if (distance < 0)
-			{
-				normal *= -1;
-				distance *= -1;
-			}
-
-			if (distance < minDist)
-			{
-				minNormal = normal;
-				minDist = distance;
-				minInd = i;
-			}
-		}
-
-		Vec2 support = GetPointGJK(*this, poly, minNormal);
-		float Distance = minNormal | support;
-		float DeltaDist = Distance - minDist;
-		float AbsDist = DeltaDist < 0 ? DeltaDist * -1 : DeltaDist;
+	for (int i = 0; i < EPA_MAX_ITERATIONS && !polytope.IsEmpty(); i++)
+	{
+		const SPolytope::SEdge& edge = polytope.GetClosestEdge();
+		minNormal = edge.normal;
+		minDist = edge.distance;
 
-		if (AbsDist > 0.001f)
-		{
-			minDist = FLT_MAX;
-			polytope.insert(polytope.begin() + minInd + 1, support);
-		}
+		Vec2 support = GetPointGJK(*this, poly, minNormal, hintA, hintB);
 
-		if (minDist != FLT_MAX)
+		// the closest edge is on the minkowski difference boundary
+		if ((minNormal | support) - minDist <= EPA_TOLERANCE || polytope.IsFull())
 			break;
-	}
-	if (minDist == FLT_MAX)
-
-		return SCollision{};
 
+		polytope.SplitClosestEdge(support);
+	}
 
-	SCollision colision;
+	SContactPoint colision;
 	colision.normal = minNormal;
-	colision.distance = minDist;
+	colision.penetration = minDist;
 
-	Vec2 point = FindFurthestPoint(minNormal) - (minNormal * minDist * 0.9999);
+	Vec2 point = FindFurthestPoint(minNormal, hintA) - (minNormal * minDist * 0.9999);
 	if (!poly.IsPointInside(point))
-		point = poly.FindFurthestPoint(-minNormal);
+		point = poly.FindFurthestPoint(-minNormal, hintB);
 
+	// support vertices of both polygons
 	colision.point = point;
+	colision.featureId = MAKE_CONTACT_FEATURE(hintA, hintB);
 	return colision;
 }
\ No newline at end of file
@@ -3,8 +3,10 @@
 
 #include <GL/glew.h>
 #include <memory>
+#include <vector>
 #include <array>
 #include <algorithm>
+#include <cstdint>
 
 #include "BoxAABB.h"
 
@@ -52,6 +54,154 @@ public:
 
 #pragma endregion
 
+#pragma region PolytopeStruct
+
+#define EPA_MAX_ITERATIONS	32
+#define EPA_TOLERANCE		0.001f
+
+// EPA polytope, fixed capacity so nothing is allocated. Its edges are kept in a heap, closest to
+// the origin on top, each new point splits the closest edge and only the two new edges are computed.
+struct SPolytope
+{
+	struct SEdge
+	{
+		uint8_t	indexA;
+		uint8_t	indexB;
+		Vec2	normal;		// outward, unit length
+		float	distance;	// from the origin
+	};
+
+	// the starting triangle, then one point per iteration
+	static const size_t MAX_POINTS = 3 + EPA_MAX_ITERATIONS;
+	static const size_t MAX_EDGES = 3 + 2 * EPA_MAX_ITERATIONS;
+
+	Vec2	points[MAX_POINTS];
+	size_t	pointCount = 0;
+
+	SEdge	edges[MAX_EDGES];
+	uint8_t	heap[MAX_EDGES];
+	size_t	heapSize = 0;
+	size_t	edgeCount = 0;
+
+	// +1 when the triangle turns counter clockwise, the splits keep its winding
+	float	winding = 1.0f;
+
+	void	Init(const Vec2& a, const Vec2& b, const Vec2& c)
+	{
+		points[0] = a;
+		points[1] = b;
+		points[2] = c;
+		pointCount = 3;
+		edgeCount = 0;
+		heapSize = 0;
+
+		winding = ((b - a) ^ (c - a)) >= 0.0f ? 1.0f : -1.0f;
+
+		AddEdge(0, 1);
+		AddEdge(1, 2);
+		AddEdge(2, 0);
+	}
+
+	bool	IsEmpty() const { return heapSize == 0; }
+	bool	IsFull() const { return pointCount == MAX_POINTS; }
+	const SEdge&	GetClosestEdge() const { return edges[heap[0]]; }
+
+	// replaces the closest edge by the two edges going through point
+	void	SplitClosestEdge(const Vec2& point)
+	{
+		SEdge edge = edges[heap[0]];
+		PopClosestEdge();
+
+		uint8_t index = (uint8_t)pointCount;
+		points[pointCount++] = point;
+
+		AddEdge(edge.indexA, index);
+		AddEdge(index, edge.indexB);
+	}
+
+	void	PopClosestEdge()
+	{
+		std::pop_heap(heap, heap + heapSize, SClosestFirst{ edges });
+		--heapSize;
+	}
+
+private:
+	// std heaps keep the largest on top
+	struct SClosestFirst
+	{
+		const SEdge*	edges;
+		bool operator()(uint8_t lhs, uint8_t rhs) const { return edges[lhs].distance > edges[rhs].distance; }
+	};
+
+	void	AddEdge(uint8_t indexA, uint8_t indexB)
+	{
+		Vec2 ab = points[indexB] - points[indexA];
+		float length = ab.GetLength();
+
+		// both ends on the same point, no normal
+		if (length <= 0.0f)
+			return;
+
+		SEdge& edge = edges[edgeCount];
+		edge.indexA = indexA;
+		edge.indexB = indexB;
+		edge.normal = Vec2(ab.y, -ab.x) * (winding / length);
+		edge.distance = edge.normal | points[indexA];
+
+		heap[heapSize++] = (uint8_t)edgeCount++;
+		std::push_heap(heap, heap + heapSize, SClosestFirst{ edges });
+	}
+};
+
+#pragma endregion
+
+// GJK state of a pair, kept from one frame to the next by the pair cache
+struct SGJKWarmStart
+{
+	// last search direction (separating axis when the polygons were apart), zero before the first call
+	Vec2	direction;
+
+	// vertices returned by the last support calls, where the next ones start climbing
+	size_t	supportA = 0;
+	size_t	supportB = 0;
+
+	// support points evaluated by the last call
+	int		supportCount = 0;
+};
+
+enum class ShapeType
+{
+	Polygon = 0,	// convex polygon, points are its vertices
+	Circle,			// points holds the center only
+	Capsule,		// points holds the two ends of the segment
+
+	Count,
+};
+
+#define MAX_CONTACT_POINTS			2
+
+// feature of each shape a contact point comes from, a vertex index or an edge index with this flag,
+// the same features give the same point from one frame to the next
+#define CONTACT_FEATURE_EDGE		0x8000
+#define MAKE_CONTACT_FEATURE(featureA, featureB)	((((uint32_t)(featureA)) << 16) | (uint32_t)(featureB))
+#define SWAP_CONTACT_FEATURE(feature)				((((feature) & 0xFFFF) << 16) | ((feature) >> 16))
+
+struct SContactPoint
+{
+	Vec2		point;				// between the two surfaces
+	Vec2		normal;				// from the first shape to the second one
+	float		penetration = 0.0f;
+
+	uint32_t	featureId = 0;
+
+	// surface points of each shape in its local space, to follow the shapes without a new test
+	Vec2		localPointA;
+	Vec2		localPointB;
+
+	// impulse along the normal given by the last step, the response starts from it
+	float		normalImpulse = 0.0f;
+};
+
 class CPolygon
 {
 private:
@@ -65,19 +215,41 @@ public:
 	Mat2				rotation;
 	std::vector<Vec2>	points;
 
+	// circles and capsules are their points inflated by radius, set before Build
+	ShapeType			shape = ShapeType::Polygon;
+	float				radius = 0.0f;
+
+	bool				IsRound() const { return shape != ShapeType::Polygon; }
+
 	void				Build();
 	void				Draw();
 	void				DrawAABB();
 	size_t				GetIndex() const;
 
-	Vec2				GetWolrdMinAABB();
-	Vec2				GetWolrdMaxAABB();
+	// world space vertices, edge normals and box, computed again only when the transform changed.
+	// The engine refreshes every polygon once at the start of the step, code reading them outside
+	// of the step after moving a polygon has to call it first
+	void				UpdateWorldSpace();
+
+	// edge i goes from world point i to world point i + 1, its normal points outside
+	const std::vector<Vec2>&	GetWorldPoints() const { return m_worldPoints; }
+	const std::vector<Vec2>&	GetWorldNormals() const { return m_worldNormals; }
+
+	// tight box in world space, from the world space cache
+	const AABB&			GetWorldAABB() const { return m_worldAABB; }
+
+	// circle around position holding the whole shape whatever its rotation, set by Build
+	float				GetBoundingRadius() const { return m_boundingRadius; }
 
 
 	Vec2				TransformPoint(const Vec2& point) const;
 	Vec2				InverseTransformPoint(const Vec2& point) const;
 	Vec2				FindFurthestPoint(Vec2 direction) const;
 
+	// same, climbing the world space vertex ring from hint, the index of the returned vertex is left in it
+	Vec2				FindFurthestPoint(const Vec2& direction, size_t& hint) const;
+	size_t				FindFurthestPointIndex(const Vec2& direction, size_t hint) const;
+
 	void				ComputeArea();
 
 	float				GetArea() const;
@@ -92,18 +264,29 @@ public:
 	// if point is outside then returned distance is negative (and doesn't make sense)
 	bool				IsPointInside(const Vec2& point) const;
 
-	bool				CheckCollision(const CPolygon& poly, Vec2& colPoint, Vec2& colNormal, float& colDist) const;
-	bool				IsMovingPositionAndRotation();
+	// fills the manifold of collision (normal from this polygon to poly), GJK starts from the
+	// warm start direction when one is given, and stores the last one back
+	bool				CheckCollision(const CPolygon& poly, SCollision& collision, SGJKWarmStart* warmStart = nullptr) const;
+
+	// GJK / EPA, for any pair of convex shapes, one contact point
+	size_t				CollideGJK(const CPolygon& poly, SContactPoint* contacts, SGJKWarmStart* warmStart) const;
 
 	float				GetDistanceAndNormal(Simplex& simplexPoints, Vec2& norm) const;
 	void				GetInfoCollisionWithEPA(Simplex& simplexPoints,const CPolygon& shapeA, const CPolygon& shapeB, Vec2& colNormal, float& colDistance) const;
-	SCollision			EPA(const Simplex& simplex, const CPolygon& poly) const;
+	SContactPoint		EPA(const Simplex& simplex, const CPolygon& poly, size_t& hintA, size_t& hintB) const;
 	// Physics
 	float				density;
 
+	// density 0 never moves, handled by the static broadphase
+	bool				IsStatic() const { return density == 0.0f; }
+
 	Vec2				speed;
 
 	float				angularVelocity = 0.0f;
+
+	// fast and small, stopped at its time of impact instead of moving through thin polygons (costs a TOI per close polygon)
+	bool				isBullet = false;
+
 	Vec2				forces;
 	float				torques = 0.0f;
 
@@ -118,19 +301,31 @@ private:
 	void				DestroyBuffers();
 
 	void				BuildLines();
+	void				BuildRound();
+	void				ComputeBoundingRadius();
+
+	// vertices drawn, the polygon itself or a tessellation of the round shapes
+	void				GetOutline(std::vector<Vec2>& outline) const;
 
 	bool				CheckSimplexTriangle(Simplex& simplexPoints, Vec2& direction) const;
 
 	GLuint				m_vertexBufferId;
+	size_t				m_vertexBufferSize = 0;
 	size_t				m_index;
 
 	std::vector<Line>	m_lines;
 
-	Vec2				savePosition;
-	Mat2				saveRotation;
+	// world space cache, see UpdateWorldSpace
+	std::vector<Vec2>	m_worldPoints;
+	std::vector<Vec2>	m_worldNormals;
+	AABB				m_worldAABB;
+	Vec2				m_worldPosition;
+	Mat2				m_worldRotation;
+	bool				m_isWorldSpaceValid = false;
 
 	float				m_signedArea;
 	float				m_localInertiaTensor;
+	float				m_boundingRadius = 0.0f;
 };
 
 typedef std::shared_ptr<CPolygon>	CPolygonPtr;
@@ -10,8 +10,10 @@
 #include "RenderWindow.h"
 #include "Polygon.h"
 #include "PhysicEngine.h"
+#include "BroadPhase.h"
 #include "SceneManager.h"
 #include "World.h"
+#include "DebugDraw.h"
 
 #include "drawtext.h"
 
@@ -112,6 +114,17 @@ void CRenderer::Update()
 		gVars->bDebug = !gVars->bDebug;
 	}
 
+	if (gVars->pRenderWindow->JustPressedKey(Key::F6))
+	{
+		BroadPhaseType next = (BroadPhaseType)(((int)gVars->pPhysicEngine->GetBroadPhaseType() + 1) % (int)BroadPhaseType::Count);
+		gVars->pPhysicEngine->SetBroadPhase(next);
+	}
+
+	if (gVars->pRenderWindow->JustPressedKey(Key::F7))
+	{
+		gVars->pPhysicEngine->SetBatchedNarrowPhase(!gVars->pPhysicEngine->IsBatchedNarrowPhase());
+	}
+
 	//Scene Update 
 	gVars->pSceneManager->CheckSceneUpdate();
 
@@ -139,6 +152,9 @@ void CRenderer::Update()
 	// Draw Polygons
 	RenderPolygons();
 
+	// what the physics drew during the step, over the polygons
+	RenderDebugDraw();
+
 	timer.Stop();
 
 	if (gVars->bDebug)
@@ -211,6 +227,21 @@ void  CRenderer::RenderPolygons()
 	glPopMatrix();
 }
 
+void  CRenderer::RenderDebugDraw()
+{
+	if (!gVars->pDebugDraw)
+		return;
+
+	gVars->pDebugDraw->Flush([this](const Vec2& from, const Vec2& to, float r, float g, float b)
+	{
+		DrawLine(from, to, r, g, b);
+	},
+	[this](const std::string& text, const Vec2& point)
+	{
+		DisplayTextWorld(text, point);
+	});
+}
+
 void  CRenderer::RenderTexts()
 {
 	int width = gVars->pRenderWindow->GetWidth();
@@ -52,6 +52,7 @@ private:
 	void	DrawFPS(float frameTime);
 	void	UpdateWorld(float frameTime);
 	void	RenderPolygons();
+	void	RenderDebugDraw();
 	void	RenderTexts();
 	void	UpdateLockFPS();
 
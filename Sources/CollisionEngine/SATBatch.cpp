@@ -0,0 +1,145 @@
+#include "SATBatch.h"
+
+#include <cfloat>
+#include <emmintrin.h>
+
+#include "SweepBoxes.h"
+
+#define SAT_BATCH_ALL_LANES		((1 << SAT_BATCH_LANES) - 1)
+
+typedef float	BatchLanes[SAT_MAX_POINTS][SAT_BATCH_LANES];
+
+// the batches are kept allocated, they are written again before being read
+void CSATBatch::Clear()
+{
+	m_pairIndices.clear();
+}
+
+static void CopyLane(const std::vector<Vec2>& source, size_t lane, BatchLanes& x, BatchLanes& y)
+{
+	for (size_t i = 0; i < SAT_MAX_POINTS; ++i)
+	{
+		const Vec2& value = source[i < source.size() ? i : 0];
+		x[i][lane] = value.x;
+		y[i][lane] = value.y;
+	}
+}
+
+void CSATBatch::Add(uint32_t pairIndex, const CPolygon& polyA, const CPolygon& polyB)
+{
+	size_t lane = m_pairIndices.size() % SAT_BATCH_LANES;
+	size_t batchIndex = m_pairIndices.size() / SAT_BATCH_LANES;
+	if (batchIndex == m_batches.size())
+		m_batches.push_back(SBatch());
+
+	SBatch& batch = m_batches[batchIndex];
+	CopyLane(polyA.GetWorldPoints(), lane, batch.pointAX, batch.pointAY);
+	CopyLane(polyA.GetWorldNormals(), lane, batch.normalAX, batch.normalAY);
+	CopyLane(polyB.GetWorldPoints(), lane, batch.pointBX, batch.pointBY);
+	CopyLane(polyB.GetWorldNormals(), lane, batch.normalBX, batch.normalBY);
+
+	batch.countA = (lane == 0) ? polyA.points.size() : Max(batch.countA, polyA.points.size());
+	batch.countB = (lane == 0) ? polyB.points.size() : Max(batch.countB, polyB.points.size());
+
+	m_pairIndices.push_back(pairIndex);
+}
+
+void CSATBatch::FindSeparated(std::vector<uint32_t>& separatedPairs) const
+{
+	bool useSSE2 = (int)GetSupportedSIMDLevel() >= (int)SIMDLevel::SSE2;
+
+	size_t batchCount = (m_pairIndices.size() + SAT_BATCH_LANES - 1) / SAT_BATCH_LANES;
+	for (size_t i = 0; i < batchCount; ++i)
+	{
+		int mask = useSSE2 ? FindSeparatedLanesSSE2(m_batches[i]) : FindSeparatedLanesScalar(m_batches[i]);
+
+		// the last batch is not always full
+		size_t first = i * SAT_BATCH_LANES;
+		for (size_t lane = 0; lane < SAT_BATCH_LANES && first + lane < m_pairIndices.size(); ++lane)
+		{
+			if (mask & (1 << lane))
+				separatedPairs.push_back(m_pairIndices[first + lane]);
+		}
+	}
+}
+
+#pragma region Scalar
+
+// largest separation along the faces of the reference polygon, like FindMaxSeparation without the climbing
+static float MaxSeparationScalar(const BatchLanes& referenceX, const BatchLanes& referenceY, const BatchLanes& normalX, const BatchLanes& normalY, size_t referenceCount,
+								 const BatchLanes& pointX, const BatchLanes& pointY, size_t pointCount, size_t lane)
+{
+	float maxSeparation = -FLT_MAX;
+	for (size_t i = 0; i < referenceCount; ++i)
+	{
+		float offset = referenceX[i][lane] * normalX[i][lane] + referenceY[i][lane] * normalY[i][lane];
+
+		float minProjection = FLT_MAX;
+		for (size_t j = 0; j < pointCount; ++j)
+			minProjection = Min(minProjection, pointX[j][lane] * normalX[i][lane] + pointY[j][lane] * normalY[i][lane]);
+
+		maxSeparation = Max(maxSeparation, minProjection - offset);
+		if (maxSeparation > 0.0f)
+			break;
+	}
+
+	return maxSeparation;
+}
+
+int CSATBatch::FindSeparatedLanesScalar(const SBatch& batch) const
+{
+	int mask = 0;
+	for (size_t lane = 0; lane < SAT_BATCH_LANES; ++lane)
+	{
+		if (MaxSeparationScalar(batch.pointAX, batch.pointAY, batch.normalAX, batch.normalAY, batch.countA, batch.pointBX, batch.pointBY, batch.countB, lane) > 0.0f ||
+			MaxSeparationScalar(batch.pointBX, batch.pointBY, batch.normalBX, batch.normalBY, batch.countB, batch.pointAX, batch.pointAY, batch.countA, lane) > 0.0f)
+			mask |= 1 << lane;
+	}
+
+	return mask;
+}
+
+#pragma endregion
+
+#pragma region SSE2
+
+// same, one pair per lane, stops once every lane found its separating axis
+static __m128 MaxSeparationSSE2(const BatchLanes& referenceX, const BatchLanes& referenceY, const BatchLanes& normalX, const BatchLanes& normalY, size_t referenceCount,
+								const BatchLanes& pointX, const BatchLanes& pointY, size_t pointCount, __m128 maxSeparation)
+{
+	__m128 zero = _mm_setzero_ps();
+
+	for (size_t i = 0; i < referenceCount; ++i)
+	{
+		if (_mm_movemask_ps(_mm_cmpgt_ps(maxSeparation, zero)) == SAT_BATCH_ALL_LANES)
+			break;
+
+		__m128 nx = _mm_loadu_ps(normalX[i]);
+		__m128 ny = _mm_loadu_ps(normalY[i]);
+		__m128 offset = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(referenceX[i]), nx), _mm_mul_ps(_mm_loadu_ps(referenceY[i]), ny));
+
+		__m128 minProjection = _mm_set1_ps(FLT_MAX);
+		for (size_t j = 0; j < pointCount; ++j)
+		{
+			__m128 projection = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pointX[j]), nx), _mm_mul_ps(_mm_loadu_ps(pointY[j]), ny));
+			minProjection = _mm_min_ps(minProjection, projection);
+		}
+
+		maxSeparation = _mm_max_ps(maxSeparation, _mm_sub_ps(minProjection, offset));
+	}
+
+	return maxSeparation;
+}
+
+int CSATBatch::FindSeparatedLanesSSE2(const SBatch& batch) const
+{
+	__m128 maxSeparation = _mm_set1_ps(-FLT_MAX);
+
+	// faces of A then faces of B, one max for both since any positive separation is enough
+	maxSeparation = MaxSeparationSSE2(batch.pointAX, batch.pointAY, batch.normalAX, batch.normalAY, batch.countA, batch.pointBX, batch.pointBY, batch.countB, maxSeparation);
+	maxSeparation = MaxSeparationSSE2(batch.pointBX, batch.pointBY, batch.normalBX, batch.normalBY, batch.countB, batch.pointAX, batch.pointAY, batch.countA, maxSeparation);
+
+	return _mm_movemask_ps(_mm_cmpgt_ps(maxSeparation, _mm_setzero_ps()));
+}
+
+#pragma endregion
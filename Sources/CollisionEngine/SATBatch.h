@@ -0,0 +1,59 @@
+#ifndef _SAT_BATCH_H_
+#define _SAT_BATCH_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "ShapeCollision.h"
+
+#define SAT_BATCH_LANES		4	// pairs tested at once, one per SSE lane
+
+// Polygon pairs of the SAT kernel (SAT_MAX_POINTS vertices or less on both sides) copied in
+// structure of arrays batches, so that the separating axis search runs on SAT_BATCH_LANES pairs
+// in lockstep. It only finds the separated pairs, the others still go through CollidePolygonsSAT
+// for their contact points.
+class CSATBatch
+{
+public:
+	void	Clear();
+
+	// the world space caches of the polygons must be up to date
+	void	Add(uint32_t pairIndex, const CPolygon& polyA, const CPolygon& polyB);
+	size_t	GetCount() const { return m_pairIndices.size(); }
+
+	// pair indices of the added pairs with a separating axis
+	void	FindSeparated(std::vector<uint32_t>& separatedPairs) const;
+
+	static bool	IsBatchable(const CPolygon& polyA, const CPolygon& polyB)
+	{
+		return !polyA.IsRound() && !polyB.IsRound() &&
+			polyA.points.size() <= SAT_MAX_POINTS && polyB.points.size() <= SAT_MAX_POINTS;
+	}
+
+private:
+	// [vertex][lane], the vertices after the last one repeat the first one
+	struct SBatch
+	{
+		float	pointAX[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	pointAY[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	normalAX[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	normalAY[SAT_MAX_POINTS][SAT_BATCH_LANES];
+
+		float	pointBX[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	pointBY[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	normalBX[SAT_MAX_POINTS][SAT_BATCH_LANES];
+		float	normalBY[SAT_MAX_POINTS][SAT_BATCH_LANES];
+
+		// most vertices of a lane
+		size_t	countA;
+		size_t	countB;
+	};
+
+	int		FindSeparatedLanesScalar(const SBatch& batch) const;
+	int		FindSeparatedLanesSSE2(const SBatch& batch) const;
+
+	std::vector<SBatch>		m_batches;
+	std::vector<uint32_t>	m_pairIndices;
+};
+
+#endif
@@ -37,6 +37,11 @@ void CSceneManager::LoadScene(size_t index)
 	gVars->pWorld = new CWorld();
 	m_scenes[index]->Create();
 
+	// static BVH saved the first time the scene is loaded, built again and saved when the statics changed
+	std::string bvhPath = "Scene" + std::to_string(index) + ".bvh";
+	if (!gVars->pPhysicEngine->LoadStaticBVH(bvhPath))
+		gVars->pPhysicEngine->SaveStaticBVH(bvhPath);
+
 	gVars->pWorld->ForEachBehavior([&](CBehaviorPtr& behavior)
 	{
 		behavior->Start();
@@ -52,7 +57,7 @@ void CSceneManager::ReloadScene()
 
 void CSceneManager::CheckSceneUpdate()
 {
-	gVars->pRenderer->DisplayText("F1: Reset scene, F2: prev scene, F3: next scene, cur scene: " + std::to_string(m_currentScene) + ", F4: debug, F5: lock FPS");
+	gVars->pRenderer->DisplayText("F1: Reset scene, F2: prev scene, F3: next scene, cur scene: " + std::to_string(m_currentScene) + ", F4: debug, F5: lock FPS, F6: broadphase " + gVars->pPhysicEngine->GetBroadPhaseName());
 
 	if (gVars->pRenderWindow->JustPressedKey(Key::F2) && m_currentScene > 0)
 	{
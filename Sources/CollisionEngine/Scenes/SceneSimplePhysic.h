@@ -34,7 +34,7 @@ private:
 		tri->position = Vec2(coeff * 5.0f, coeff * 15.0f);
 		tri->density *= 5.0f;
 		//
-		gVars->pWorld->AddSymetricPolygon(coeff * 10.0f, 50)->position = Vec2(-coeff * 20.0f, coeff * 5.0f);
+		gVars->pWorld->AddCircle(coeff * 10.0f)->position = Vec2(-coeff * 20.0f, coeff * 5.0f);
 	}
 
 	float m_scale;
@@ -27,13 +27,14 @@ private:
 			}
 		}		
 		
-		CPolygonPtr circle = gVars->pWorld->AddSymetricPolygon(1.0f * m_scale, 50);
+		CPolygonPtr circle = gVars->pWorld->AddCircle(1.0f * m_scale);
 		circle->position = Vec2(5.0f * m_scale, -2.5f * m_scale);
 		
 		
 		circle->speed.x = -60.0f * m_scale;
 		circle->speed.y = 0.0f * m_scale;
 		circle->density = 0.3f;
+		circle->isBullet = true;
 	}
 
 	float m_scale;
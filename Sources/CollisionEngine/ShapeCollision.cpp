@@ -0,0 +1,457 @@
+#include "ShapeCollision.h"
+
+#include <utility>
+
+#define SHAPE_COLLISION_EPSILON		1e-8f	// squared length under which a segment is a point
+#define CAPSULE_PARALLEL_TOLERANCE	0.05f	// sine of the angle under which a capsule lies on a face
+
+// point of a clipped segment, with the features it comes from
+struct SClipVertex
+{
+	Vec2		point;
+	uint32_t	featureId;
+};
+
+// segment (or point) the round shape inflates
+static void GetCore(const CPolygon& round, Vec2& start, Vec2& end)
+{
+	const std::vector<Vec2>& worldPoints = round.GetWorldPoints();
+	start = worldPoints.front();
+	end = worldPoints.back();
+}
+
+// vertex at one of the ends of a segment, or the edge in between
+static uint32_t GetSegmentFeature(float t, uint32_t startVertex, uint32_t endVertex, uint32_t edge)
+{
+	if (t <= 0.0f)
+		return startVertex;
+	if (t >= 1.0f)
+		return endVertex;
+	return CONTACT_FEATURE_EDGE | edge;
+}
+
+// Closest points of segments [p1, q1] and [p2, q2], any of them can be a point, returns the squared distance.
+// s and t are the positions of the closest points along each segment, from 0 to 1
+static float ClosestPointsOnSegments(const Vec2& p1, const Vec2& q1, const Vec2& p2, const Vec2& q2, Vec2& closest1, Vec2& closest2, float& s, float& t)
+{
+	Vec2 d1 = q1 - p1;
+	Vec2 d2 = q2 - p2;
+	Vec2 r = p1 - p2;
+
+	float a = d1 | d1;
+	float e = d2 | d2;
+	float f = d2 | r;
+
+	s = 0.0f;
+	t = 0.0f;
+
+	if (a <= SHAPE_COLLISION_EPSILON && e > SHAPE_COLLISION_EPSILON)
+	{
+		t = Clamp(f / e, 0.0f, 1.0f);
+	}
+	else if (a > SHAPE_COLLISION_EPSILON)
+	{
+		float c = d1 | r;
+		if (e <= SHAPE_COLLISION_EPSILON)
+		{
+			s = Clamp(-c / a, 0.0f, 1.0f);
+		}
+		else
+		{
+			// closest points of the infinite lines, then clamped on each segment
+			float b = d1 | d2;
+			float denom = a * e - b * b;
+
+			s = (denom != 0.0f) ? Clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = Clamp(-c / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f)
+			{
+				t = 1.0f;
+				s = Clamp((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	closest1 = p1 + d1 * s;
+	closest2 = p2 + d2 * t;
+	return (closest1 - closest2).GetSqrLength();
+}
+
+// Keeps the part of the segment in front of the plane (point | normal >= offset), a point made
+// by the cut gets newFeatureId
+static size_t ClipSegment(const SClipVertex* input, SClipVertex* output, const Vec2& normal, float offset, uint32_t newFeatureId)
+{
+	size_t count = 0;
+
+	float distance0 = (input[0].point | normal) - offset;
+	float distance1 = (input[1].point | normal) - offset;
+
+	if (distance0 >= 0.0f)
+		output[count++] = input[0];
+	if (distance1 >= 0.0f)
+		output[count++] = input[1];
+
+	// ends on both sides
+	if (distance0 * distance1 < 0.0f)
+	{
+		output[count].point = input[0].point + (input[1].point - input[0].point) * (distance0 / (distance0 - distance1));
+		output[count].featureId = newFeatureId;
+		++count;
+	}
+
+	return count;
+}
+
+// Clips the incident segment between the side planes of the reference face [reference0, reference1]
+// and keeps the points closer than radius to the face. Incident vertices carry their own feature only,
+// the face is added here. Features are (reference, incident), normals go from the reference face.
+static size_t ClipIncidentSegment(const SClipVertex* incident, uint32_t incidentEdge, float radius,
+	const Vec2& reference0, const Vec2& reference1, uint32_t referenceFace, uint32_t referenceVertex0, uint32_t referenceVertex1,
+	const Vec2& normal, SContactPoint* contacts)
+{
+	Vec2 tangent = (reference1 - reference0).Normalized();
+
+	SClipVertex clipped0[3];
+	if (ClipSegment(incident, clipped0, tangent, reference0 | tangent, MAKE_CONTACT_FEATURE(referenceVertex0, CONTACT_FEATURE_EDGE | incidentEdge)) < 2)
+		return 0;
+
+	SClipVertex clipped1[3];
+	if (ClipSegment(clipped0, clipped1, -tangent, -(reference1 | tangent), MAKE_CONTACT_FEATURE(referenceVertex1, CONTACT_FEATURE_EDGE | incidentEdge)) < 2)
+		return 0;
+
+	size_t contactCount = 0;
+	for (size_t i = 0; i < 2; ++i)
+	{
+		float separation = ((clipped1[i].point - reference0) | normal) - radius;
+		if (separation > 0.0f)
+			continue;
+
+		// incident vertex kept by the clipping
+		uint32_t featureId = clipped1[i].featureId;
+		if (featureId <= 0xFFFF)
+			featureId = MAKE_CONTACT_FEATURE(CONTACT_FEATURE_EDGE | referenceFace, featureId);
+
+		SContactPoint& contact = contacts[contactCount++];
+		contact.penetration = -separation;
+		contact.point = clipped1[i].point - normal * (radius + separation * 0.5f);
+		contact.normal = normal;
+		contact.featureId = featureId;
+	}
+
+	return contactCount;
+}
+
+// normals and features of contacts made with the shapes swapped
+static void SwapContacts(SContactPoint* contacts, size_t contactCount)
+{
+	for (size_t i = 0; i < contactCount; ++i)
+	{
+		contacts[i].normal = -contacts[i].normal;
+		contacts[i].featureId = SWAP_CONTACT_FEATURE(contacts[i].featureId);
+	}
+}
+
+size_t	CollidePolygonRound(const CPolygon& poly, const CPolygon& round, SContactPoint* contacts)
+{
+	size_t contactCount = CollideRoundPolygon(round, poly, contacts);
+	SwapContacts(contacts, contactCount);
+	return contactCount;
+}
+
+size_t	CollideRoundCores(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts)
+{
+	Vec2 startA, endA, startB, endB;
+	GetCore(shapeA, startA, endA);
+	GetCore(shapeB, startB, endB);
+
+	Vec2 closestA, closestB;
+	float s, t;
+	float sqrDist = ClosestPointsOnSegments(startA, endA, startB, endB, closestA, closestB, s, t);
+
+	float radii = shapeA.radius + shapeB.radius;
+	if (sqrDist > radii * radii)
+		return 0;
+
+	SContactPoint& contact = contacts[0];
+	contact.featureId = MAKE_CONTACT_FEATURE(GetSegmentFeature(s, 0, 1, 0), GetSegmentFeature(t, 0, 1, 0));
+
+	if (sqrDist > SHAPE_COLLISION_EPSILON)
+	{
+		float dist = sqrtf(sqrDist);
+		contact.normal = (closestB - closestA) / dist;
+		contact.penetration = radii - dist;
+	}
+	else
+	{
+		// crossing segments, smallest push along the normals and directions of the segments
+		Vec2 axes[4] = { (endA - startA), (endA - startA).GetNormal(), (endB - startB), (endB - startB).GetNormal() };
+
+		contact.penetration = FLT_MAX;
+		contact.normal = Vec2(0.0f, 1.0f);
+		for (Vec2 axis : axes)
+		{
+			if (axis.GetSqrLength() <= SHAPE_COLLISION_EPSILON)
+				continue;
+			axis.Normalize();
+
+			float maxA = Max(startA | axis, endA | axis) + shapeA.radius;
+			float minA = Min(startA | axis, endA | axis) - shapeA.radius;
+			float maxB = Max(startB | axis, endB | axis) + shapeB.radius;
+			float minB = Min(startB | axis, endB | axis) - shapeB.radius;
+
+			if (maxA - minB < contact.penetration)
+			{
+				contact.penetration = maxA - minB;
+				contact.normal = axis;
+			}
+			if (maxB - minA < contact.penetration)
+			{
+				contact.penetration = maxB - minA;
+				contact.normal = -axis;
+			}
+		}
+
+		// same center for two circles
+		if (contact.penetration == FLT_MAX)
+			contact.penetration = radii;
+	}
+
+	// between the two surfaces
+	contact.point = ((closestA + contact.normal * shapeA.radius) + (closestB - contact.normal * shapeB.radius)) * 0.5f;
+	return 1;
+}
+
+// Core outside of the polygon : closest points of the core and the polygon edges.
+// Core crossing the polygon : separating axis with the smallest penetration, among the polygon
+// normals and the normal of the segment.
+// A capsule parallel to the face it touches is clipped against it, for a point at each end.
+size_t	CollideRoundPolygon(const CPolygon& round, const CPolygon& poly, SContactPoint* contacts)
+{
+	const std::vector<Vec2>& polyPoints = poly.GetWorldPoints();
+	const std::vector<Vec2>& polyNormals = poly.GetWorldNormals();
+	size_t count = polyPoints.size();
+
+	Vec2 start, end;
+	GetCore(round, start, end);
+
+	float minSqrDist = FLT_MAX;
+	Vec2 closestRound, closestPoly;
+	uint32_t featureId = 0;
+	size_t closestEdge = 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t next = (i + 1 == count) ? 0 : i + 1;
+
+		Vec2 onRound, onPoly;
+		float s, t;
+		float sqrDist = ClosestPointsOnSegments(start, end, polyPoints[i], polyPoints[next], onRound, onPoly, s, t);
+		if (sqrDist < minSqrDist)
+		{
+			minSqrDist = sqrDist;
+			closestRound = onRound;
+			closestPoly = onPoly;
+			closestEdge = i;
+			featureId = MAKE_CONTACT_FEATURE(GetSegmentFeature(s, 0, 1, 0), GetSegmentFeature(t, (uint32_t)i, (uint32_t)next, (uint32_t)i));
+		}
+	}
+
+	bool crossing = minSqrDist <= SHAPE_COLLISION_EPSILON || poly.IsPointInside(start);
+
+	// from the polygon to the round shape, face is the polygon face it goes through if any
+	Vec2 normal;
+	float penetration;
+	size_t face = count;
+
+	if (!crossing)
+	{
+		if (minSqrDist > round.radius * round.radius)
+			return 0;
+
+		float dist = sqrtf(minSqrDist);
+		normal = (closestRound - closestPoly) / dist;
+		penetration = round.radius - dist;
+
+		if (featureId & CONTACT_FEATURE_EDGE)
+			face = closestEdge;
+	}
+	else
+	{
+		penetration = FLT_MAX;
+
+		// pushed out through each face, the polygon is convex so its furthest point is on the face
+		for (size_t i = 0; i < count; ++i)
+		{
+			float facePenetration = (polyPoints[i] | polyNormals[i]) - (Min(start | polyNormals[i], end | polyNormals[i]) - round.radius);
+			if (facePenetration < penetration)
+			{
+				penetration = facePenetration;
+				normal = polyNormals[i];
+				face = i;
+			}
+		}
+
+		// pushed out sideways from the capsule segment, both ways
+		Vec2 axis = end - start;
+		if (axis.GetSqrLength() > SHAPE_COLLISION_EPSILON)
+		{
+			Vec2 axisNormal = axis.GetNormal().Normalized();
+
+			float polyMin = FLT_MAX;
+			float polyMax = -FLT_MAX;
+			for (const Vec2& point : polyPoints)
+			{
+				polyMin = Min(polyMin, point | axisNormal);
+				polyMax = Max(polyMax, point | axisNormal);
+			}
+
+			float segment = start | axisNormal;
+			if (polyMax - (segment - round.radius) < penetration)
+			{
+				penetration = polyMax - (segment - round.radius);
+				normal = axisNormal;
+				face = count;
+			}
+			if ((segment + round.radius) - polyMin < penetration)
+			{
+				penetration = (segment + round.radius) - polyMin;
+				normal = -axisNormal;
+				face = count;
+			}
+		}
+
+		featureId = MAKE_CONTACT_FEATURE(CONTACT_FEATURE_EDGE, (face < count) ? (CONTACT_FEATURE_EDGE | (uint32_t)face) : 0);
+	}
+
+	// capsule lying on a polygon face
+	Vec2 axis = end - start;
+	if (face < count && axis.GetSqrLength() > SHAPE_COLLISION_EPSILON &&
+		fabsf(axis | polyNormals[face]) <= CAPSULE_PARALLEL_TOLERANCE * axis.GetLength())
+	{
+		size_t next = (face + 1 == count) ? 0 : face + 1;
+		SClipVertex incident[2] = { { start, 0 }, { end, 1 } };
+
+		size_t contactCount = ClipIncidentSegment(incident, 0, round.radius, polyPoints[face], polyPoints[next],
+			(uint32_t)face, (uint32_t)face, (uint32_t)next, polyNormals[face], contacts);
+
+		if (contactCount > 0)
+		{
+			// made for the polygon against the capsule
+			SwapContacts(contacts, contactCount);
+			return contactCount;
+		}
+	}
+
+	SContactPoint& contact = contacts[0];
+	contact.normal = -normal;
+	contact.penetration = penetration;
+	contact.featureId = featureId;
+
+	if (!crossing)
+	{
+		contact.point = (closestPoly + (closestRound - normal * round.radius)) * 0.5f;
+		return 1;
+	}
+
+	// deepest point of the round shape
+	Vec2 deepest = ((start | normal) < (end | normal)) ? start : end;
+	contact.point = deepest - normal * (round.radius - penetration * 0.5f);
+	return 1;
+}
+
+// Largest separation of poly along the faces of reference, the deepest vertex of poly for each face
+// comes from climbing its vertex ring, starting from the one of the previous face
+static float FindMaxSeparation(const CPolygon& reference, const CPolygon& poly, size_t& bestFace)
+{
+	const std::vector<Vec2>& referencePoints = reference.GetWorldPoints();
+	const std::vector<Vec2>& referenceNormals = reference.GetWorldNormals();
+	const std::vector<Vec2>& polyPoints = poly.GetWorldPoints();
+
+	float maxSeparation = -FLT_MAX;
+	size_t hint = 0;
+
+	for (size_t i = 0; i < referenceNormals.size(); ++i)
+	{
+		const Vec2& normal = referenceNormals[i];
+
+		hint = poly.FindFurthestPointIndex(-normal, hint);
+		float separation = (polyPoints[hint] - referencePoints[i]) | normal;
+
+		if (separation > maxSeparation)
+		{
+			maxSeparation = separation;
+			bestFace = i;
+
+			// separating axis
+			if (separation > 0.0f)
+				break;
+		}
+	}
+
+	return maxSeparation;
+}
+
+size_t	CollidePolygonsSAT(const CPolygon& polyA, const CPolygon& polyB, SContactPoint* contacts)
+{
+	size_t faceA = 0;
+	float separationA = FindMaxSeparation(polyA, polyB, faceA);
+	if (separationA > 0.0f)
+		return 0;
+
+	size_t faceB = 0;
+	float separationB = FindMaxSeparation(polyB, polyA, faceB);
+	if (separationB > 0.0f)
+		return 0;
+
+	// prefer A, so that the reference face does not flip between two frames for close separations
+	bool flip = separationB > 0.98f * separationA + 0.001f;
+
+	const CPolygon& reference = flip ? polyB : polyA;
+	const CPolygon& incident = flip ? polyA : polyB;
+	size_t referenceFace = flip ? faceB : faceA;
+
+	const std::vector<Vec2>& referencePoints = reference.GetWorldPoints();
+	const std::vector<Vec2>& incidentPoints = incident.GetWorldPoints();
+	const std::vector<Vec2>& incidentNormals = incident.GetWorldNormals();
+
+	const Vec2& normal = reference.GetWorldNormals()[referenceFace];
+	size_t referenceNext = (referenceFace + 1 == referencePoints.size()) ? 0 : referenceFace + 1;
+
+	// incident edge, of the two around the deepest vertex the one facing the reference face the most
+	size_t count = incidentPoints.size();
+	size_t deepest = incident.FindFurthestPointIndex(-normal, 0);
+	size_t previous = (deepest == 0) ? count - 1 : deepest - 1;
+	size_t incidentFace = ((incidentNormals[deepest] | normal) < (incidentNormals[previous] | normal)) ? deepest : previous;
+	size_t incidentNext = (incidentFace + 1 == count) ? 0 : incidentFace + 1;
+
+	SClipVertex incidentEdge[2] = { { incidentPoints[incidentFace], (uint32_t)incidentFace }, { incidentPoints[incidentNext], (uint32_t)incidentNext } };
+
+	size_t contactCount = ClipIncidentSegment(incidentEdge, (uint32_t)incidentFace, 0.0f, referencePoints[referenceFace], referencePoints[referenceNext],
+		(uint32_t)referenceFace, (uint32_t)referenceFace, (uint32_t)referenceNext, normal, contacts);
+
+	// features are (reference, incident) and normals go from the reference
+	if (flip)
+		SwapContacts(contacts, contactCount);
+
+	return contactCount;
+}
+
+template<ShapeType TypeA, size_t... TypesB>
+static constexpr std::array<CollisionKernel, SHAPE_TYPE_COUNT> MakeKernelRow(std::index_sequence<TypesB...>)
+{
+	return {{ &SCollisionKernel<TypeA, (ShapeType)TypesB>::Collide... }};
+}
+
+template<size_t... TypesA>
+static constexpr CollisionKernelTable MakeKernelTable(std::index_sequence<TypesA...>)
+{
+	return {{ MakeKernelRow<(ShapeType)TypesA>(std::make_index_sequence<SHAPE_TYPE_COUNT>())... }};
+}
+
+extern const CollisionKernelTable gCollisionKernels = MakeKernelTable(std::make_index_sequence<SHAPE_TYPE_COUNT>());
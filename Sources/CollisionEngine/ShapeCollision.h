@@ -0,0 +1,99 @@
+#ifndef _SHAPE_COLLISION_H_
+#define _SHAPE_COLLISION_H_
+
+#include <array>
+
+#include "Polygon.h"
+
+#define SAT_MAX_POINTS		8	// polygons with more vertices go through GJK / EPA
+
+// Specialised tests, used instead of GJK / EPA when they apply. They fill up to MAX_CONTACT_POINTS
+// contacts, with normals going from the first shape to the second one, and return their count.
+// The world space caches must be up to date. A round shape is a point or a segment (its core)
+// inflated by its radius.
+
+// both shapes are round, closest points of the two cores
+size_t	CollideRoundCores(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts);
+
+// round shape against a polygon, a capsule lying on a face touches it in two points
+size_t	CollideRoundPolygon(const CPolygon& round, const CPolygon& poly, SContactPoint* contacts);
+
+// same with the shapes the other way around
+size_t	CollidePolygonRound(const CPolygon& poly, const CPolygon& round, SContactPoint* contacts);
+
+// Separating axis test of two convex polygons with early out. The incident edge is clipped against the
+// reference face (the face of least penetration), giving up to two contact points
+size_t	CollidePolygonsSAT(const CPolygon& polyA, const CPolygon& polyB, SContactPoint* contacts);
+
+
+// Kernels of the dispatch table, one per pair of shape types. The table is filled at compile time
+// from SCollisionKernel<TypeA, TypeB>, a new test is plugged in by specialising it, nothing else
+// to change. Pairs without a specialisation go through GJK / EPA.
+
+#define SHAPE_TYPE_COUNT	((size_t)ShapeType::Count)
+
+typedef size_t (*CollisionKernel)(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart* warmStart);
+typedef std::array<std::array<CollisionKernel, SHAPE_TYPE_COUNT>, SHAPE_TYPE_COUNT> CollisionKernelTable;
+
+constexpr bool IsRoundShape(ShapeType type) { return type != ShapeType::Polygon; }
+
+template<ShapeType TypeA, ShapeType TypeB, bool IsRoundA = IsRoundShape(TypeA), bool IsRoundB = IsRoundShape(TypeB)>
+struct SCollisionKernel
+{
+	static size_t Collide(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart* warmStart)
+	{
+		return shapeA.CollideGJK(shapeB, contacts, warmStart);
+	}
+};
+
+// circles and capsules have a closed form, no support point needed
+template<ShapeType TypeA, ShapeType TypeB>
+struct SCollisionKernel<TypeA, TypeB, true, true>
+{
+	static size_t Collide(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart*)
+	{
+		return CollideRoundCores(shapeA, shapeB, contacts);
+	}
+};
+
+template<ShapeType TypeA>
+struct SCollisionKernel<TypeA, ShapeType::Polygon, true, false>
+{
+	static size_t Collide(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart*)
+	{
+		return CollideRoundPolygon(shapeA, shapeB, contacts);
+	}
+};
+
+template<ShapeType TypeB>
+struct SCollisionKernel<ShapeType::Polygon, TypeB, false, true>
+{
+	static size_t Collide(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart*)
+	{
+		return CollidePolygonRound(shapeA, shapeB, contacts);
+	}
+};
+
+// boxes and small polygons, cheaper with SAT and the contact points are clipped, not guessed
+template<>
+struct SCollisionKernel<ShapeType::Polygon, ShapeType::Polygon, false, false>
+{
+	static size_t Collide(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart* warmStart)
+	{
+		if (shapeA.points.size() <= SAT_MAX_POINTS && shapeB.points.size() <= SAT_MAX_POINTS)
+			return CollidePolygonsSAT(shapeA, shapeB, contacts);
+
+		return shapeA.CollideGJK(shapeB, contacts, warmStart);
+	}
+};
+
+// [typeA][typeB], built at compile time
+extern const CollisionKernelTable gCollisionKernels;
+
+// one indexed call, no virtual nor switch
+inline size_t	CollideShapes(const CPolygon& shapeA, const CPolygon& shapeB, SContactPoint* contacts, SGJKWarmStart* warmStart)
+{
+	return gCollisionKernels[(size_t)shapeA.shape][(size_t)shapeB.shape](shapeA, shapeB, contacts, warmStart);
+}
+
+#endif
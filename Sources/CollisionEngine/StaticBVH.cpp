@@ -0,0 +1,291 @@
+#include "StaticBVH.h"
+
+#include <algorithm>
+
+void CStaticBVH::Clear()
+{
+	m_nodes.clear();
+	m_items.clear();
+	m_itemBoxes.clear();
+}
+
+void CStaticBVH::Build(const std::vector<AABB>& boxes)
+{
+	Clear();
+
+	if (boxes.empty())
+		return;
+
+	m_items.resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		m_items[i] = (uint32_t)i;
+	}
+	m_itemBoxes = boxes;
+
+	m_nodes.reserve(2 * boxes.size());
+	BuildNode(0, (uint32_t)boxes.size(), 0);
+
+	for (size_t i = 0; i < m_items.size(); ++i)
+	{
+		m_itemBoxes[i] = boxes[m_items[i]];
+	}
+}
+
+uint32_t CStaticBVH::BuildNode(uint32_t first, uint32_t count, uint32_t depth)
+{
+	uint32_t nodeIndex = (uint32_t)m_nodes.size();
+	m_nodes.push_back(SStaticBVHNode());
+
+	AABB box = m_itemBoxes[m_items[first]];
+	AABB centers(box.GetCenter(), box.GetCenter());
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		const AABB& itemBox = m_itemBoxes[m_items[i]];
+		box = AABB::Combine(box, itemBox);
+		centers.Extend(itemBox.GetCenter());
+	}
+	m_nodes[nodeIndex].box = box;
+
+	// the traversal keeps at most one pending node per level
+	if (count <= STATIC_BVH_LEAF_SIZE || depth + 1 >= STATIC_BVH_MAX_DEPTH)
+	{
+		m_nodes[nodeIndex].offset = first;
+		m_nodes[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	// all centers at the same place, nothing to bin, the median split still bounds the depth
+	uint32_t leftCount = 0;
+	Vec2 centersSize = centers.GetSize();
+	if (centersSize.x <= 0.0f && centersSize.y <= 0.0f)
+	{
+		leftCount = PartitionMedian(first, count, centers);
+	}
+	else
+	{
+		leftCount = PartitionSAH(first, count, box, centers);
+
+		// no split cheaper than testing all the items, bigger leaf
+		if (leftCount == 0)
+		{
+			m_nodes[nodeIndex].offset = first;
+			m_nodes[nodeIndex].count = count;
+			return nodeIndex;
+		}
+	}
+
+	BuildNode(first, leftCount, depth + 1);
+	uint32_t right = BuildNode(first + leftCount, count - leftCount, depth + 1);
+
+	m_nodes[nodeIndex].offset = right;
+	m_nodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+bool CStaticBVH::IsBuiltFor(const std::vector<AABB>& boxes) const
+{
+	if (m_items.size() != boxes.size())
+		return false;
+
+	for (size_t i = 0; i < m_items.size(); ++i)
+	{
+		const AABB& box = boxes[m_items[i]];
+		if (!(m_itemBoxes[i].minPoint == box.minPoint) || !(m_itemBoxes[i].maxPoint == box.maxPoint))
+			return false;
+	}
+
+	return true;
+}
+
+// Cost of a split is count * perimeter of both sides, the centers are binned along each axis
+uint32_t CStaticBVH::PartitionSAH(uint32_t first, uint32_t count, const AABB& box, const AABB& centers)
+{
+	struct SBin
+	{
+		AABB		box;
+		uint32_t	count = 0;
+	};
+
+	float bestCost = (float)count * box.GetPerimeter();
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	Vec2 centersSize = centers.GetSize();
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		float axisMin = (axis == 0) ? centers.minPoint.x : centers.minPoint.y;
+		float axisSize = (axis == 0) ? centersSize.x : centersSize.y;
+		if (axisSize <= 0.0f)
+			continue;
+
+		float binScale = STATIC_BVH_SAH_BINS / axisSize;
+
+		SBin bins[STATIC_BVH_SAH_BINS];
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			const AABB& itemBox = m_itemBoxes[m_items[i]];
+			Vec2 center = itemBox.GetCenter();
+			int bin = Min((int)(((axis == 0 ? center.x : center.y) - axisMin) * binScale), STATIC_BVH_SAH_BINS - 1);
+
+			bins[bin].box = (bins[bin].count == 0) ? itemBox : AABB::Combine(bins[bin].box, itemBox);
+			++bins[bin].count;
+		}
+
+		// right side costs, swept from the last bin
+		float rightCosts[STATIC_BVH_SAH_BINS];
+		AABB rightBox;
+		uint32_t rightCount = 0;
+		for (int bin = STATIC_BVH_SAH_BINS - 1; bin > 0; --bin)
+		{
+			if (bins[bin].count > 0)
+			{
+				rightBox = (rightCount == 0) ? bins[bin].box : AABB::Combine(rightBox, bins[bin].box);
+				rightCount += bins[bin].count;
+			}
+			rightCosts[bin] = (rightCount == 0) ? 0.0f : (float)rightCount * rightBox.GetPerimeter();
+		}
+
+		// split between bin - 1 and bin
+		AABB leftBox;
+		uint32_t leftCount = 0;
+		for (int bin = 1; bin < STATIC_BVH_SAH_BINS; ++bin)
+		{
+			if (bins[bin - 1].count > 0)
+			{
+				leftBox = (leftCount == 0) ? bins[bin - 1].box : AABB::Combine(leftBox, bins[bin - 1].box);
+				leftCount += bins[bin - 1].count;
+			}
+
+			if (leftCount == 0 || leftCount == count)
+				continue;
+
+			float cost = (float)leftCount * leftBox.GetPerimeter() + rightCosts[bin];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+		return 0;
+
+	float axisMin = (bestAxis == 0) ? centers.minPoint.x : centers.minPoint.y;
+	float binScale = STATIC_BVH_SAH_BINS / ((bestAxis == 0) ? centersSize.x : centersSize.y);
+
+	auto middle = std::partition(m_items.begin() + first, m_items.begin() + first + count, [&](uint32_t item)
+	{
+		Vec2 center = m_itemBoxes[item].GetCenter();
+		int bin = Min((int)(((bestAxis == 0 ? center.x : center.y) - axisMin) * binScale), STATIC_BVH_SAH_BINS - 1);
+		return bin < bestBin;
+	});
+
+	return (uint32_t)(middle - (m_items.begin() + first));
+}
+
+// Median split of the centers along the longest axis
+uint32_t CStaticBVH::PartitionMedian(uint32_t first, uint32_t count, const AABB& centers)
+{
+	Vec2 size = centers.GetSize();
+	bool splitX = size.x >= size.y;
+
+	uint32_t half = count / 2;
+	std::nth_element(m_items.begin() + first, m_items.begin() + first + half, m_items.begin() + first + count, [&](uint32_t a, uint32_t b)
+	{
+		Vec2 centerA = m_itemBoxes[a].GetCenter();
+		Vec2 centerB = m_itemBoxes[b].GetCenter();
+		return splitX ? centerA.x < centerB.x : centerA.y < centerB.y;
+	});
+
+	return half;
+}
+
+/*
+
+	SERIALIZATION
+
+*/
+
+#pragma region Serialization
+
+template<typename T>
+static void WriteArray(std::ostream& stream, const std::vector<T>& values)
+{
+	if (!values.empty())
+		stream.write((const char*)values.data(), sizeof(T) * values.size());
+}
+
+template<typename T>
+static void ReadArray(std::istream& stream, std::vector<T>& values, uint32_t count)
+{
+	values.resize(count);
+	if (count > 0)
+		stream.read((char*)values.data(), sizeof(T) * count);
+}
+
+bool CStaticBVH::Save(std::ostream& stream) const
+{
+	uint32_t header[4] = { STATIC_BVH_FILE_MAGIC, STATIC_BVH_FILE_VERSION, (uint32_t)m_nodes.size(), (uint32_t)m_items.size() };
+	stream.write((const char*)header, sizeof(header));
+
+	WriteArray(stream, m_nodes);
+	WriteArray(stream, m_items);
+	WriteArray(stream, m_itemBoxes);
+
+	return stream.good();
+}
+
+bool CStaticBVH::Load(std::istream& stream)
+{
+	Clear();
+
+	uint32_t header[4];
+	if (!stream.read((char*)header, sizeof(header)))
+		return false;
+
+	if (header[0] != STATIC_BVH_FILE_MAGIC || header[1] != STATIC_BVH_FILE_VERSION)
+		return false;
+
+	uint32_t nodeCount = header[2];
+	uint32_t itemCount = header[3];
+
+	// a tree over n items has at most 2n - 1 nodes
+	if ((nodeCount == 0) != (itemCount == 0) || nodeCount > 2 * (uint64_t)itemCount)
+		return false;
+
+	ReadArray(stream, m_nodes, nodeCount);
+	ReadArray(stream, m_items, itemCount);
+	ReadArray(stream, m_itemBoxes, itemCount);
+
+	// children after their parent and depth in the traversal stack
+	bool valid = !stream.fail();
+	std::vector<uint32_t> depths(nodeCount, 0);
+	for (size_t i = 0; valid && i < m_nodes.size(); ++i)
+	{
+		const SStaticBVHNode& node = m_nodes[i];
+		if (node.count > 0)
+		{
+			valid = (uint64_t)node.offset + node.count <= itemCount;
+		}
+		else
+		{
+			valid = node.offset > i + 1 && node.offset < nodeCount && depths[i] + 1 < STATIC_BVH_MAX_DEPTH;
+			if (valid)
+				depths[i + 1] = depths[node.offset] = depths[i] + 1;
+		}
+	}
+	for (size_t i = 0; valid && i < m_items.size(); ++i)
+	{
+		valid = m_items[i] < itemCount;
+	}
+
+	if (!valid)
+		Clear();
+
+	return valid;
+}
+
+#pragma endregion
@@ -0,0 +1,96 @@
+#ifndef _STATIC_BVH_H_
+#define _STATIC_BVH_H_
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include "Maths.h"
+
+#define STATIC_BVH_LEAF_SIZE	4	// max items in a leaf
+#define STATIC_BVH_MAX_DEPTH	64	// traversal stack size
+#define STATIC_BVH_SAH_BINS		16	// split candidates per axis
+#define STATIC_BVH_FILE_MAGIC	0x48564253	// "SBVH"
+#define STATIC_BVH_FILE_VERSION	1
+
+struct SStaticBVHNode
+{
+	AABB		box;
+
+	// leaf : first item in the item list, inner node : right child (left child is the next node)
+	uint32_t	offset;
+
+	// items in a leaf, 0 for an inner node
+	uint32_t	count;
+};
+
+// Bounding volume hierarchy built once over boxes that never move.
+// Splits are chosen with the surface area heuristic (perimeter in 2D) over a few bins,
+// nodes are stored depth first in a single array, no pointer to chase.
+class CStaticBVH
+{
+public:
+	void		Clear();
+
+	// items are the indices in boxes
+	void		Build(const std::vector<AABB>& boxes);
+
+	// binary dump of the built tree, so that it does not have to be built again at load
+	bool		Save(std::ostream& stream) const;
+	bool		Load(std::istream& stream);
+
+	size_t		GetNodeCount() const { return m_nodes.size(); }
+	size_t		GetItemCount() const { return m_items.size(); }
+	AABB		GetBounds() const { return m_nodes.empty() ? AABB() : m_nodes[0].box; }
+
+	// true when the tree holds exactly these boxes, item i having boxes[i]
+	bool		IsBuiltFor(const std::vector<AABB>& boxes) const;
+
+	// calls functor(item) for every item whose box strictly overlaps this one
+	template<typename TFunctor>
+	void		Query(const AABB& box, TFunctor functor) const
+	{
+		if (m_nodes.empty())
+			return;
+
+		uint32_t stack[STATIC_BVH_MAX_DEPTH];
+		size_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const SStaticBVHNode& node = m_nodes[stack[--stackSize]];
+			if (!node.box.Overlaps(box))
+				continue;
+
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+				{
+					if (m_itemBoxes[i].Overlaps(box))
+						functor(m_items[i]);
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.offset;
+				stack[stackSize++] = (uint32_t)(&node - &m_nodes[0]) + 1;
+			}
+		}
+	}
+
+private:
+	uint32_t	BuildNode(uint32_t first, uint32_t count, uint32_t depth);
+
+	// returns the item count of the left child, 0 when no split is better than a leaf
+	uint32_t	PartitionSAH(uint32_t first, uint32_t count, const AABB& box, const AABB& centers);
+	uint32_t	PartitionMedian(uint32_t first, uint32_t count, const AABB& centers);
+
+	std::vector<SStaticBVHNode>	m_nodes;
+
+	// items ordered by leaf, with a copy of their box next to them
+	std::vector<uint32_t>		m_items;
+	std::vector<AABB>			m_itemBoxes;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "StaticBroadPhase.h"
+
+#include "Polygon.h"
+#include "GlobalVariables.h"
+#include "World.h"
+
+void CStaticBroadPhase::Clear()
+{
+	m_proxies.clear();
+	m_boxes.clear();
+	m_tree.Clear();
+}
+
+void CStaticBroadPhase::GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck)
+{
+	if (SyncProxies())
+		Rebuild();
+
+	if (m_proxies.empty())
+		return;
+
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygon* poly = gVars->pWorld->GetPolygon(i).get();
+		if (poly->IsStatic())
+			continue;
+
+		m_tree.Query(poly->GetWorldAABB(), [&](uint32_t item)
+		{
+			CPolygon* staticPoly = m_proxies[item].poly;
+
+			// lowest index first, like the other broadphases
+			if (staticPoly->GetIndex() < i)
+				pairsToCheck.push_back(SPolygonPair(staticPoly, poly));
+			else
+				pairsToCheck.push_back(SPolygonPair(poly, staticPoly));
+
+			poly->boxAABB.isCollide = true;
+			staticPoly->boxAABB.isCollide = true;
+		});
+	}
+}
+
+bool CStaticBroadPhase::SaveTree(std::ostream& stream)
+{
+	if (SyncProxies())
+		Rebuild();
+
+	return m_tree.Save(stream);
+}
+
+bool CStaticBroadPhase::LoadTree(std::istream& stream)
+{
+	SyncProxies();
+
+	if (!m_tree.Load(stream))
+	{
+		Rebuild();
+		return false;
+	}
+
+	// built for other polygons, a layout with the same count and bounds is not enough
+	m_boxes.resize(m_proxies.size());
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		m_boxes[i] = m_proxies[i].poly->GetWorldAABB();
+	}
+
+	if (!m_tree.IsBuiltFor(m_boxes))
+	{
+		Rebuild();
+		return false;
+	}
+
+	return true;
+}
+
+// Returns true when a static polygon was added, removed or moved since the last build
+bool CStaticBroadPhase::SyncProxies()
+{
+	bool changed = false;
+	size_t staticCount = 0;
+
+	size_t polyCount = gVars->pWorld->GetPolygonCount();
+	for (size_t i = 0; i < polyCount; ++i)
+	{
+		CPolygon* poly = gVars->pWorld->GetPolygon(i).get();
+		if (!poly->IsStatic())
+			continue;
+
+		if (staticCount == m_proxies.size())
+		{
+			m_proxies.push_back(SStaticProxy());
+			changed = true;
+		}
+
+		SStaticProxy& proxy = m_proxies[staticCount++];
+		if (proxy.poly != poly || !(proxy.position == poly->position) ||
+			!(proxy.rotation.X == poly->rotation.X) || !(proxy.rotation.Y == poly->rotation.Y))
+		{
+			proxy.poly = poly;
+			proxy.position = poly->position;
+			proxy.rotation = poly->rotation;
+			changed = true;
+		}
+	}
+
+	if (staticCount != m_proxies.size())
+	{
+		m_proxies.resize(staticCount);
+		changed = true;
+	}
+
+	return changed;
+}
+
+void CStaticBroadPhase::Rebuild()
+{
+	m_boxes.resize(m_proxies.size());
+	for (size_t i = 0; i < m_proxies.size(); ++i)
+	{
+		m_boxes[i] = m_proxies[i].poly->GetWorldAABB();
+	}
+
+	m_tree.Build(m_boxes);
+	++m_buildCount;
+}
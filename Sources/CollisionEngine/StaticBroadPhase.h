@@ -0,0 +1,50 @@
+#ifndef _STATIC_BROAD_PHASE_H_
+#define _STATIC_BROAD_PHASE_H_
+
+#include <vector>
+#include <iostream>
+
+#include "PhysicEngine.h"
+#include "Maths.h"
+#include "StaticBVH.h"
+
+struct SStaticProxy
+{
+	CPolygon*	poly = nullptr;
+
+	// transform used by the last build
+	Vec2		position;
+	Mat2		rotation;
+};
+
+// Static polygons (density 0) are kept out of the broadphases, in a BVH built once
+// and only rebuilt when one of them is added or moved. Dynamic polygons query it,
+// so static pairs are never generated.
+class CStaticBroadPhase
+{
+public:
+	void	Clear();
+
+	// adds the dynamic / static pairs
+	void	GetCollidingPairsToCheck(std::vector<SPolygonPair>& pairsToCheck);
+
+	// the tree built over the current static polygons, a loaded tree is used as long as
+	// the static polygons do not change, instead of building it again
+	bool	SaveTree(std::ostream& stream);
+	bool	LoadTree(std::istream& stream);
+
+	size_t	GetStaticCount() const { return m_proxies.size(); }
+	size_t	GetBuildCount() const { return m_buildCount; }
+
+private:
+	bool	SyncProxies();
+	void	Rebuild();
+
+	std::vector<SStaticProxy>	m_proxies;
+	std::vector<AABB>			m_boxes;
+	CStaticBVH					m_tree;
+
+	size_t						m_buildCount = 0;
+};
+
+#endif
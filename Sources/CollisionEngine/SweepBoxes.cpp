@@ -0,0 +1,221 @@
+#include "SweepBoxes.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SWEEP_TARGET_AVX
+#else
+#define SWEEP_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+#pragma region SIMD level
+
+static SIMDLevel DetectSIMDLevel()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// the OS must also save the ymm registers
+	if (osxsave && avx && (_xgetbv(0) & 6) == 6)
+		return SIMDLevel::AVX;
+
+	return sse2 ? SIMDLevel::SSE2 : SIMDLevel::Scalar;
+#else
+	if (__builtin_cpu_supports("avx"))
+		return SIMDLevel::AVX;
+
+	return __builtin_cpu_supports("sse2") ? SIMDLevel::SSE2 : SIMDLevel::Scalar;
+#endif
+}
+
+static SIMDLevel s_supportedLevel = DetectSIMDLevel();
+static SIMDLevel s_sweepLevel = s_supportedLevel;
+
+SIMDLevel GetSupportedSIMDLevel()
+{
+	return s_supportedLevel;
+}
+
+SIMDLevel GetSweepSIMDLevel()
+{
+	return s_sweepLevel;
+}
+
+void SetSweepSIMDLevel(SIMDLevel level)
+{
+	s_sweepLevel = ((int)level <= (int)s_supportedLevel) ? level : s_supportedLevel;
+}
+
+const char* GetSIMDLevelName(SIMDLevel level)
+{
+	switch (level)
+	{
+	case SIMDLevel::SSE2:	return "SSE2";
+	case SIMDLevel::AVX:	return "AVX";
+	default:				return "Scalar";
+	}
+}
+
+#pragma endregion
+
+static uint64_t	MakePairKey(uint32_t a, uint32_t b)
+{
+	return (a < b) ? (((uint64_t)a << 32) | b) : (((uint64_t)b << 32) | a);
+}
+
+CSweepBoxes::CSweepBoxes()
+{
+	Clear();
+}
+
+void CSweepBoxes::Clear()
+{
+	m_ids.clear();
+	m_minX.assign(SWEEP_BOXES_PADDING, INFINITY);
+	m_maxX.assign(SWEEP_BOXES_PADDING, INFINITY);
+	m_minY.assign(SWEEP_BOXES_PADDING, INFINITY);
+	m_maxY.assign(SWEEP_BOXES_PADDING, INFINITY);
+}
+
+void CSweepBoxes::Reserve(size_t count)
+{
+	m_ids.reserve(count);
+	m_minX.reserve(count + SWEEP_BOXES_PADDING);
+	m_maxX.reserve(count + SWEEP_BOXES_PADDING);
+	m_minY.reserve(count + SWEEP_BOXES_PADDING);
+	m_maxY.reserve(count + SWEEP_BOXES_PADDING);
+}
+
+void CSweepBoxes::Add(uint32_t id, const AABB& box)
+{
+	// the new box takes the place of the first sentinel, and one is added at the end
+	size_t index = m_ids.size();
+	m_ids.push_back(id);
+
+	m_minX[index] = box.minPoint.x;
+	m_maxX[index] = box.maxPoint.x;
+	m_minY[index] = box.minPoint.y;
+	m_maxY[index] = box.maxPoint.y;
+
+	m_minX.push_back(INFINITY);
+	m_maxX.push_back(INFINITY);
+	m_minY.push_back(INFINITY);
+	m_maxY.push_back(INFINITY);
+}
+
+AABB CSweepBoxes::GetBox(size_t index) const
+{
+	return AABB(Vec2(m_minX[index], m_minY[index]), Vec2(m_maxX[index], m_maxY[index]));
+}
+
+void CSweepBoxes::FindOverlaps(std::vector<uint64_t>& pairKeys) const
+{
+	switch (s_sweepLevel)
+	{
+	case SIMDLevel::AVX:	FindOverlapsAVX(pairKeys); break;
+	case SIMDLevel::SSE2:	FindOverlapsSSE2(pairKeys); break;
+	default:				FindOverlapsScalar(pairKeys); break;
+	}
+}
+
+void CSweepBoxes::FindOverlapsScalar(std::vector<uint64_t>& pairKeys) const
+{
+	size_t count = m_ids.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		float maxX = m_maxX[i];
+		float minX = m_minX[i];
+		float minY = m_minY[i];
+		float maxY = m_maxY[i];
+
+		// sentinels are at infinity, they stop the sweep
+		for (size_t j = i + 1; m_minX[j] < maxX; ++j)
+		{
+			if (m_maxX[j] > minX && m_minY[j] < maxY && m_maxY[j] > minY)
+				pairKeys.push_back(MakePairKey(m_ids[i], m_ids[j]));
+		}
+	}
+}
+
+void CSweepBoxes::FindOverlapsSSE2(std::vector<uint64_t>& pairKeys) const
+{
+	size_t count = m_ids.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		__m128 maxX = _mm_set1_ps(m_maxX[i]);
+		__m128 minX = _mm_set1_ps(m_minX[i]);
+		__m128 minY = _mm_set1_ps(m_minY[i]);
+		__m128 maxY = _mm_set1_ps(m_maxY[i]);
+
+		for (size_t j = i + 1; ; j += 4)
+		{
+			// boxes are sorted along x, once a lane is out of the sweep all the next ones are
+			int inSweep = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(&m_minX[j]), maxX));
+			if (inSweep == 0)
+				break;
+
+			__m128 overlap = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(&m_maxX[j]), minX),
+							 _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&m_minY[j]), maxY),
+										_mm_cmpgt_ps(_mm_loadu_ps(&m_maxY[j]), minY)));
+
+			int mask = inSweep & _mm_movemask_ps(overlap);
+			while (mask != 0)
+			{
+				int lane = 0;
+				while ((mask & (1 << lane)) == 0)
+					++lane;
+
+				pairKeys.push_back(MakePairKey(m_ids[i], m_ids[j + lane]));
+				mask &= mask - 1;
+			}
+
+			if (inSweep != 0xF)
+				break;
+		}
+	}
+}
+
+SWEEP_TARGET_AVX void CSweepBoxes::FindOverlapsAVX(std::vector<uint64_t>& pairKeys) const
+{
+	size_t count = m_ids.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		__m256 maxX = _mm256_set1_ps(m_maxX[i]);
+		__m256 minX = _mm256_set1_ps(m_minX[i]);
+		__m256 minY = _mm256_set1_ps(m_minY[i]);
+		__m256 maxY = _mm256_set1_ps(m_maxY[i]);
+
+		for (size_t j = i + 1; ; j += 8)
+		{
+			int inSweep = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_minX[j]), maxX, _CMP_LT_OQ));
+			if (inSweep == 0)
+				break;
+
+			__m256 overlap = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_maxX[j]), minX, _CMP_GT_OQ),
+							 _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&m_minY[j]), maxY, _CMP_LT_OQ),
+										   _mm256_cmp_ps(_mm256_loadu_ps(&m_maxY[j]), minY, _CMP_GT_OQ)));
+
+			int mask = inSweep & _mm256_movemask_ps(overlap);
+			while (mask != 0)
+			{
+				int lane = 0;
+				while ((mask & (1 << lane)) == 0)
+					++lane;
+
+				pairKeys.push_back(MakePairKey(m_ids[i], m_ids[j + lane]));
+				mask &= mask - 1;
+			}
+
+			if (inSweep != 0xFF)
+				break;
+		}
+	}
+	_mm256_zeroupper();
+}
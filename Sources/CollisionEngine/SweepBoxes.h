@@ -0,0 +1,57 @@
+#ifndef _SWEEP_BOXES_H_
+#define _SWEEP_BOXES_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "Maths.h"
+
+#define SWEEP_BOXES_PADDING		8	// sentinel boxes after the last one, a whole SIMD register can always be loaded
+
+enum class SIMDLevel : int
+{
+	Scalar = 0,
+	SSE2,
+	AVX,
+};
+
+// best level supported by the CPU, checked once
+SIMDLevel	GetSupportedSIMDLevel();
+
+// level used by the sweeps, defaults to the supported one (clamped to it when forced)
+SIMDLevel	GetSweepSIMDLevel();
+void		SetSweepSIMDLevel(SIMDLevel level);
+const char*	GetSIMDLevelName(SIMDLevel level);
+
+// Boxes sorted along x stored as separate arrays, so that one box is tested
+// against 4 (SSE2) or 8 (AVX) of the following ones at once.
+class CSweepBoxes
+{
+public:
+	CSweepBoxes();
+
+	void		Clear();
+	void		Reserve(size_t count);
+
+	// must be added by increasing minPoint.x
+	void		Add(uint32_t id, const AABB& box);
+
+	size_t		GetCount() const { return m_ids.size(); }
+	uint32_t	GetId(size_t index) const { return m_ids[index]; }
+	AABB		GetBox(size_t index) const;
+
+	// strictly overlapping boxes, key is (lowId << 32 | highId)
+	void		FindOverlaps(std::vector<uint64_t>& pairKeys) const;
+
+private:
+	void		FindOverlapsScalar(std::vector<uint64_t>& pairKeys) const;
+	void		FindOverlapsSSE2(std::vector<uint64_t>& pairKeys) const;
+	void		FindOverlapsAVX(std::vector<uint64_t>& pairKeys) const;
+
+	std::vector<uint32_t>	m_ids;
+
+	// padded with SWEEP_BOXES_PADDING empty boxes at infinity
+	std::vector<float>		m_minX, m_maxX, m_minY, m_maxY;
+};
+
+#endif
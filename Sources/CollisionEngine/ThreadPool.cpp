@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+CThreadPool::CThreadPool(size_t threadCount)
+	: m_task(nullptr), m_taskCount(0), m_nextIndex(0), m_pendingWorkers(0), m_jobId(0), m_quit(false)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+
+	// the caller is the first thread
+	for (size_t i = 1; i < threadCount; ++i)
+	{
+		m_threads.push_back(std::thread(&CThreadPool::WorkerMain, this, i));
+	}
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+size_t CThreadPool::GetThreadCount() const
+{
+	return m_threads.size() + 1;
+}
+
+void CThreadPool::ParallelFor(size_t count, const std::function<void(size_t, size_t)>& task)
+{
+	if (count == 0)
+		return;
+
+	// not worth waking anybody
+	if (count == 1 || m_threads.empty())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			task(i, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_taskCount = count;
+		m_nextIndex = 0;
+		m_pendingWorkers = m_threads.size();
+		++m_jobId;
+	}
+	m_wakeCondition.notify_all();
+
+	RunTasks(0);
+
+	// every worker has to check in, the task must outlive them
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_pendingWorkers == 0; });
+	m_task = nullptr;
+}
+
+void CThreadPool::WorkerMain(size_t threadIndex)
+{
+	uint64_t lastJobId = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [&]() { return m_quit || m_jobId != lastJobId; });
+
+			if (m_quit)
+				return;
+
+			lastJobId = m_jobId;
+		}
+
+		RunTasks(threadIndex);
+
+		bool isLast;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			isLast = (--m_pendingWorkers == 0);
+		}
+
+		if (isLast)
+			m_doneCondition.notify_one();
+	}
+}
+
+void CThreadPool::RunTasks(size_t threadIndex)
+{
+	while (true)
+	{
+		size_t index = m_nextIndex++;
+		if (index >= m_taskCount)
+			return;
+
+		(*m_task)(index, threadIndex);
+	}
+}
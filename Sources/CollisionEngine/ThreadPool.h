@@ -0,0 +1,46 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Fixed set of worker threads sleeping between jobs.
+// The calling thread works too, so thread indices go from 0 (caller) to GetThreadCount() - 1.
+class CThreadPool
+{
+public:
+	// 0 means one thread per hardware thread
+	CThreadPool(size_t threadCount = 0);
+	~CThreadPool();
+
+	size_t	GetThreadCount() const;
+
+	// calls task(index, threadIndex) for every index in [0, count) and returns once all are done,
+	// indices are handed out one by one so the calls order is not fixed. Not reentrant.
+	void	ParallelFor(size_t count, const std::function<void(size_t, size_t)>& task);
+
+private:
+	void	WorkerMain(size_t threadIndex);
+	void	RunTasks(size_t threadIndex);
+
+	std::vector<std::thread>	m_threads;
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_wakeCondition;
+	std::condition_variable		m_doneCondition;
+
+	// current job
+	const std::function<void(size_t, size_t)>*	m_task;
+	size_t						m_taskCount;
+	std::atomic<size_t>			m_nextIndex;
+	size_t						m_pendingWorkers;
+	uint64_t					m_jobId;
+	bool						m_quit;
+};
+
+#endif
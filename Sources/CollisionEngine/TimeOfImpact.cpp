@@ -0,0 +1,170 @@
+#include "TimeOfImpact.h"
+
+#include <cfloat>
+
+// points of the shape in world space, without the radius of the round shapes
+static void TransformCore(const CPolygon& shape, const Vec2& position, const Mat2& rotation, std::vector<Vec2>& core)
+{
+	core.resize(shape.points.size());
+	for (size_t i = 0; i < shape.points.size(); ++i)
+	{
+		core[i] = rotation * shape.points[i] + position;
+	}
+}
+
+// a single point has one degenerate edge, a segment has one edge
+static size_t GetEdgeCount(const std::vector<Vec2>& core)
+{
+	return core.size() < 3 ? 1 : core.size();
+}
+
+static Vec2 ClosestPointOnSegment(const Vec2& point, const Vec2& start, const Vec2& end)
+{
+	Vec2 segment = end - start;
+	float sqrLength = segment.GetSqrLength();
+	float t = sqrLength > 0.0f ? Clamp(((point - start) | segment) / sqrLength, 0.0f, 1.0f) : 0.0f;
+
+	return start + segment * t;
+}
+
+static bool AreApartAlong(const std::vector<Vec2>& coreA, const std::vector<Vec2>& coreB, const Vec2& axis)
+{
+	float minA = FLT_MAX, maxA = -FLT_MAX;
+	for (const Vec2& point : coreA)
+	{
+		float projection = point | axis;
+		minA = Min(minA, projection);
+		maxA = Max(maxA, projection);
+	}
+
+	float minB = FLT_MAX, maxB = -FLT_MAX;
+	for (const Vec2& point : coreB)
+	{
+		float projection = point | axis;
+		minB = Min(minB, projection);
+		maxB = Max(maxB, projection);
+	}
+
+	return maxA < minB || maxB < minA;
+}
+
+// separating axis test, the edge normals of both cores, plus the direction of a segment
+static bool AreCoresOverlapping(const std::vector<Vec2>& coreA, const std::vector<Vec2>& coreB)
+{
+	// two points overlap only when they are at the same place, the distance already said no
+	if (coreA.size() == 1 && coreB.size() == 1)
+		return false;
+
+	for (const std::vector<Vec2>* core : { &coreA, &coreB })
+	{
+		if (core->size() == 1)
+			continue;
+
+		for (size_t i = 0; i < GetEdgeCount(*core); ++i)
+		{
+			Vec2 edge = (*core)[(i + 1) % core->size()] - (*core)[i];
+			if (AreApartAlong(coreA, coreB, Vec2(-edge.y, edge.x)))
+				return false;
+
+			if (core->size() == 2 && AreApartAlong(coreA, coreB, edge))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+float	CTimeOfImpact::ComputeDistance(const CPolygon& shapeA, const Vec2& positionA, const Mat2& rotationA,
+									   const CPolygon& shapeB, const Vec2& positionB, const Mat2& rotationB, Vec2& normal)
+{
+	TransformCore(shapeA, positionA, rotationA, m_coreA);
+	TransformCore(shapeB, positionB, rotationB, m_coreB);
+
+	// closest vertex / edge of the two cores, from A to B
+	float minSqrDistance = FLT_MAX;
+	Vec2 minOffset;
+
+	for (size_t i = 0; i < GetEdgeCount(m_coreB); ++i)
+	{
+		const Vec2& start = m_coreB[i];
+		const Vec2& end = m_coreB[(i + 1) % m_coreB.size()];
+
+		for (const Vec2& point : m_coreA)
+		{
+			Vec2 offset = ClosestPointOnSegment(point, start, end) - point;
+			if (offset.GetSqrLength() < minSqrDistance)
+			{
+				minSqrDistance = offset.GetSqrLength();
+				minOffset = offset;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < GetEdgeCount(m_coreA); ++i)
+	{
+		const Vec2& start = m_coreA[i];
+		const Vec2& end = m_coreA[(i + 1) % m_coreA.size()];
+
+		for (const Vec2& point : m_coreB)
+		{
+			Vec2 offset = point - ClosestPointOnSegment(point, start, end);
+			if (offset.GetSqrLength() < minSqrDistance)
+			{
+				minSqrDistance = offset.GetSqrLength();
+				minOffset = offset;
+			}
+		}
+	}
+
+	if (minSqrDistance <= 0.0f || AreCoresOverlapping(m_coreA, m_coreB))
+		return 0.0f;
+
+	float coreDistance = sqrtf(minSqrDistance);
+	normal = minOffset * (1.0f / coreDistance);
+
+	return Max(coreDistance - shapeA.radius - shapeB.radius, 0.0f);
+}
+
+float	CTimeOfImpact::Compute(const CPolygon& shapeA, const CPolygon& shapeB, float deltaTime)
+{
+	// static polygons never move, whatever their speed says
+	Vec2 speedA = shapeA.IsStatic() ? Vec2() : shapeA.speed;
+	Vec2 speedB = shapeB.IsStatic() ? Vec2() : shapeB.speed;
+	float angularVelocityA = shapeA.IsStatic() ? 0.0f : shapeA.angularVelocity;
+	float angularVelocityB = shapeB.IsStatic() ? 0.0f : shapeB.angularVelocity;
+
+	// A against B, in distance per step
+	Vec2 displacement = (speedA - speedB) * deltaTime;
+	float rotationBound = fabsf(angularVelocityA * deltaTime) * shapeA.GetBoundingRadius() + fabsf(angularVelocityB * deltaTime) * shapeB.GetBoundingRadius();
+
+	float t = 0.0f;
+	for (int i = 0; i < TOI_MAX_ITERATIONS; ++i)
+	{
+		Mat2 rotationA = shapeA.rotation;
+		Mat2 rotationB = shapeB.rotation;
+		rotationA.Rotate(RAD2DEG(angularVelocityA * deltaTime * t));
+		rotationB.Rotate(RAD2DEG(angularVelocityB * deltaTime * t));
+
+		Vec2 normal;
+		float distance = ComputeDistance(shapeA, shapeA.position + speedA * (deltaTime * t), rotationA,
+										 shapeB, shapeB.position + speedB * (deltaTime * t), rotationB, normal);
+
+		// already overlapping at the start
+		if (distance <= 0.0f && t == 0.0f)
+			return 1.0f;
+
+		// fastest a point of A can get closer to B along the normal, sliding along B costs nothing
+		float closingBound = Max(displacement | normal, 0.0f) + rotationBound;
+		if (closingBound <= 0.0f)
+			return 1.0f;
+
+		if (distance <= TOI_TOLERANCE)
+			return Min(t + (distance + TOI_TARGET_PENETRATION) / closingBound, 1.0f);
+
+		t += distance / closingBound;
+		if (t >= 1.0f)
+			return 1.0f;
+	}
+
+	return t;
+}
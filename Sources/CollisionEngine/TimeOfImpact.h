@@ -0,0 +1,32 @@
+#ifndef _TIME_OF_IMPACT_H_
+#define _TIME_OF_IMPACT_H_
+
+#include <vector>
+
+#include "Polygon.h"
+
+#define TOI_MAX_ITERATIONS		20
+#define TOI_TOLERANCE			0.005f	// distance under which the shapes are considered in contact
+#define TOI_TARGET_PENETRATION	0.01f	// how far the shapes are pushed into each other at the impact, so the discrete test sees it
+
+// Conservative advancement: the shapes move with their speed and angular velocity during deltaTime, from
+// their current transform, and are advanced by their distance divided by the largest speed at which a point
+// can close it, so they never pass through each other. Returns the fraction of deltaTime at the impact, 1 when
+// there is none or when the shapes already overlap at the start (the discrete test handles them).
+class CTimeOfImpact
+{
+public:
+	float	Compute(const CPolygon& shapeA, const CPolygon& shapeB, float deltaTime);
+
+	// distance between the shapes placed at the given transforms, 0 when they overlap,
+	// normal goes from the closest point of shapeA to the one of shapeB
+	float	ComputeDistance(const CPolygon& shapeA, const Vec2& positionA, const Mat2& rotationA,
+							const CPolygon& shapeB, const Vec2& positionB, const Mat2& rotationB, Vec2& normal);
+
+private:
+	// kept between calls, no allocation once they are big enough
+	std::vector<Vec2>	m_coreA;
+	std::vector<Vec2>	m_coreB;
+};
+
+#endif
@@ -49,6 +49,33 @@ CPolygonPtr		CWorld::AddSymetricPolygon(float radius, size_t sides)
 	return poly;
 }
 
+CPolygonPtr		CWorld::AddCircle(float radius)
+{
+	CPolygonPtr poly = AddPolygon();
+	poly->shape = ShapeType::Circle;
+	poly->radius = radius;
+	poly->points.push_back({ 0.0f, 0.0f });
+	poly->Build();
+
+	return poly;
+}
+
+// length of the segment, along x, the total length is length + 2 * radius
+CPolygonPtr		CWorld::AddCapsule(float radius, float length)
+{
+	if (length <= 0.0f)
+		return AddCircle(radius);
+
+	CPolygonPtr poly = AddPolygon();
+	poly->shape = ShapeType::Capsule;
+	poly->radius = radius;
+	poly->points.push_back({ -length * 0.5f, 0.0f });
+	poly->points.push_back({ length * 0.5f, 0.0f });
+	poly->Build();
+
+	return poly;
+}
+
 CPolygonPtr		CWorld::AddRandomPoly(const SRandomPolyParams& params)
 {
 	size_t pointsCount = (size_t)Random(params.minPoints, params.maxPoints);
@@ -74,6 +101,9 @@ CPolygonPtr		CWorld::AddRandomPoly(const SRandomPolyParams& params)
 	rot.SetAngle(Random(-180.0f, 180.0f));
 	poly->speed = rot.X * Random(params.minSpeed, params.maxSpeed);
 
+	// placed after the build
+	poly->UpdateWorldSpace();
+
 	return poly;
 }
 
@@ -133,6 +163,14 @@ void	CWorld::Update(float frameTime)
 	}
 }
 
+void	CWorld::UpdateWorldSpace()
+{
+	for (const CPolygonPtr& polygon : m_polygons)
+	{
+		polygon->UpdateWorldSpace();
+	}
+}
+
 void	CWorld::RenderPolygons(bool drawAABB)
 {
 	for (CPolygonPtr polygon : m_polygons)
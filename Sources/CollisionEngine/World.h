@@ -23,6 +23,10 @@ public:
 	CPolygonPtr		AddSymetricPolygon(float radius, size_t sides);
 	CPolygonPtr		AddRandomPoly(const SRandomPolyParams& params);
 
+	// exact round shapes, far cheaper to collide than a polygon with many sides
+	CPolygonPtr		AddCircle(float radius);
+	CPolygonPtr		AddCapsule(float radius, float length);
+
 	CPolygonPtr		AddPolygon();
 	void			RemovePolygon(CPolygonPtr poly);
 
@@ -59,6 +63,9 @@ public:
 	}
 
 	void Update(float frameTime);
+
+	// world space vertices of every moved polygon, see CPolygon::UpdateWorldSpace
+	void UpdateWorldSpace();
 	void RenderPolygons(bool drawAABB);
 
 protected: